@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -23,14 +23,37 @@ SOURCES += main.cpp\
     super_xbr.cpp \
     menuactions.cpp \
     commandchain.cpp \
-    importsettings.cpp
+    importsettings.cpp \
+    spritedecoder.cpp \
+    pixelconvert.cpp \
+    importpipeline.cpp \
+    spritefile.cpp \
+    spriteencoder.cpp \
+    batchconvert.cpp \
+    reversedither.cpp \
+    linearlight.cpp \
+    framearena.cpp \
+    tilemap.cpp
 
 HEADERS  += spritebuilder.h \
     imageview.h \
     byteswap.h \
     spritetable.h \
     commandchain.h \
-    importsettings.h
+    importsettings.h \
+    spritedecoder.h \
+    pixelconvert.h \
+    simd.h \
+    importpipeline.h \
+    spritefile.h \
+    spriteencoder.h \
+    batchconvert.h \
+    pallet_dta.h \
+    reversedither.h \
+    imagebands.h \
+    linearlight.h \
+    framearena.h \
+    tilemap.h
 
 FORMS    += spritebuilder.ui \
     importsettings.ui
@@ -0,0 +1,393 @@
+#include "batchconvert.h"
+#include "importsettings.h"
+#include "importpipeline.h"
+#include "spritedecoder.h"
+#include "spritefile.h"
+#include "imageview.h"
+#include "framearena.h"
+#include <QCommandLineParser>
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QFileInfo>
+#include <QDir>
+#include <QSharedPointer>
+#include <QMap>
+#include <QElapsedTimer>
+#include <memory>
+#include <cstring>
+
+struct convert_file
+{
+	QString input, output;
+
+	QSharedPointer<SpriteDecoder> decoder;
+	QSharedPointer<const import_source> source;
+
+	std::vector<import_job> jobs;
+	bool okay;
+};
+
+struct convert_frame
+{
+	convert_file * file;
+	size_t job;
+	bool okay;
+};
+
+bool isBatchConvert(int argc, char * argv[])
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		if(!strcmp(argv[i], "--convert")
+		|| !strcmp(argv[i], "--benchmark"))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static
+bool isSprite(const QFileInfo & info)
+{
+	return info.isFile() && findSpriteFormat(info.fileName());
+}
+
+static
+QStringList expandInputs(const QStringList & arguments)
+{
+	QStringList files;
+
+	for(auto & argument : arguments)
+	{
+		QFileInfo info(argument);
+
+		if(info.isDir())
+		{
+			for(auto & entry : QDir(argument).entryInfoList(QDir::Files, QDir::Name))
+			{
+				if(isSprite(entry))
+				{
+					files.push_back(entry.filePath());
+				}
+			}
+		}
+		else if(argument.contains('*') || argument.contains('?'))
+		{
+			QDir dir = info.dir();
+			for(auto & entry : dir.entryInfoList(QStringList(info.fileName()), QDir::Files, QDir::Name))
+			{
+				if(isSprite(entry))
+				{
+					files.push_back(entry.filePath());
+				}
+			}
+		}
+		else
+		{
+			files.push_back(argument);
+		}
+	}
+
+	return files;
+}
+
+static
+bool writeC32(const convert_file & file)
+{
+	FILE * out = fopen(QFile::encodeName(file.output).constData(), "wb");
+
+	if(!out)
+	{
+		return false;
+	}
+
+	std::vector<std::unique_ptr<ImageView> > views;
+	std::vector<sprite_row> rows(file.jobs.size());
+
+	for(size_t i = 0; i < file.jobs.size(); ++i)
+	{
+		if(file.jobs[i].frame < 0)
+		{
+			continue;
+		}
+
+//same conversion as inserting the frame into the table, without the thumbnail
+		views.emplace_back(new ImageView(i, BAKED_IMAGE_SLOT));
+		views.back()->setImage(file.jobs[i].image, false);
+		rows[i].push_back(views.back().get());
+	}
+
+	writeSpriteFile(out, rows);
+	fclose(out);
+	return true;
+}
+
+//decodes, processes and writes the files, returns how many of them failed
+static
+int convertFiles(std::vector<convert_file> & files, const import_settings & settings, bool print_passes)
+{
+	std::vector<convert_frame> frames;
+
+	for(auto & file : files)
+	{
+		const sprite_format * format;
+		SpriteDecoder::Status status;
+		file.decoder = openSprite(file.input, &format, &status);
+		file.okay = status == SpriteDecoder::Okay;
+
+		if(!file.okay)
+		{
+			fprintf(stderr, "Unable to read sprite '%s'.\n", qPrintable(file.input));
+			continue;
+		}
+
+		file.source = planImport(file.decoder, *format, file.input, settings, file.jobs);
+
+		for(size_t j = 0; j < file.jobs.size(); ++j)
+		{
+			frames.push_back(convert_frame{ &file, j, true });
+		}
+	}
+
+//the frames of all the files go through the pool together so small files don't leave cores idle
+	QtConcurrent::blockingMap(frames, [](convert_frame & frame)
+	{
+		auto & source = *frame.file->source;
+		frame.okay = runImportJob(frame.file->jobs[frame.job], source.settings, source.decode);
+	});
+
+//a file with a frame that couldn't be read isn't written at all rather than with a blank frame
+	for(auto & frame : frames)
+	{
+		if(!frame.okay)
+		{
+			fprintf(stderr, "Frame %d of '%s' could not be decoded.\n", frame.file->jobs[frame.job].frame, qPrintable(frame.file->input));
+			frame.file->okay = false;
+		}
+	}
+
+	QtConcurrent::blockingMap(files, [](convert_file & file)
+	{
+		if(file.okay && !writeC32(file))
+		{
+			fprintf(stderr, "Unable to write '%s'.\n", qPrintable(file.output));
+			file.okay = false;
+		}
+	});
+
+	int failed = 0;
+
+	for(auto & file : files)
+	{
+		if(file.okay)
+		{
+			printf("%s -> %s\n", qPrintable(file.input), qPrintable(file.output));
+
+			for(size_t i = 0; print_passes && i < file.jobs.size(); ++i)
+			{
+				if(file.jobs[i].frame >= 0)
+				{
+					printf("\tframe %d: %d color, %d alpha passes\n", file.jobs[i].frame, file.jobs[i].color_passes, file.jobs[i].alpha_passes);
+				}
+			}
+		}
+		else
+		{
+			++failed;
+		}
+
+//done with the file, its frames and mapping can go before the next ones are opened
+		file.jobs.clear();
+		file.source.clear();
+		file.decoder.clear();
+	}
+
+	return failed;
+}
+
+struct benchmark_frame
+{
+	const SpriteDecoder * decoder;
+	int frame;
+	import_job job;
+};
+
+//best of repeat runs of every frame on the pool, in seconds
+template<typename F>
+static
+double timeFrames(std::vector<benchmark_frame> & frames, int repeat, F f)
+{
+	double best = 0;
+
+	for(int i = 0; i < repeat; ++i)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		QtConcurrent::blockingMap(frames, f);
+		double t = timer.nsecsElapsed() / 1e9;
+		best = (i == 0 || t < best)? t : best;
+	}
+
+	return best;
+}
+
+//decodes every file with each registered format that reads it, once for the decoder alone and
+//once through the whole import pipeline with the given settings.
+static
+int runBenchmark(const QStringList & inputs, const import_settings & settings, int repeat)
+{
+	printf("%-24s %6s %8s %9s %12s %12s %12s %14s\n", "format", "files", "frames", "MB", "decode MB/s", "decode fps", "import fps", "scratch allocs");
+
+	for(auto & format : spriteFormats())
+	{
+		std::vector<QSharedPointer<SpriteDecoder> > decoders;
+		std::vector<benchmark_frame> frames;
+		size_t bytes = 0;
+
+		for(auto & input : inputs)
+		{
+			if(findSpriteFormat(input) != &format)
+			{
+				continue;
+			}
+
+			QSharedPointer<SpriteDecoder> decoder(format.create());
+
+			if(decoder->open(input) != SpriteDecoder::Okay)
+			{
+				fprintf(stderr, "Unable to read sprite '%s'.\n", qPrintable(input));
+				continue;
+			}
+
+			for(int i = 0; i < decoder->frameCount(); ++i)
+			{
+				QSize size = decoder->frameSize(i);
+				frames.push_back(benchmark_frame{ decoder.data(), i, import_job(i, size.width(), size.height()) });
+			}
+
+			bytes += decoder->fileSize();
+			decoders.push_back(decoder);
+		}
+
+		if(frames.empty())
+		{
+			continue;
+		}
+
+		double decode = timeFrames(frames, repeat, [&settings](benchmark_frame & f)
+		{
+			QImage image = allocateFrame(f.job.width, f.job.height, settings);
+			f.decoder->decodeFrame(f.frame, image);
+		});
+
+		auto run_import = [&settings](benchmark_frame & f)
+		{
+			import_job job = f.job;
+			runImportJob(job, settings, [&f](import_job & job) { return f.decoder->decodeFrame(job.frame, job.image); });
+		};
+
+		double pipeline = timeFrames(frames, repeat, run_import);
+
+//the timed runs warmed up the arenas, one more should not need any more scratch memory
+		arena_stats before = arenaStats();
+		timeFrames(frames, 1, run_import);
+		arena_stats after = arenaStats();
+
+		printf("%-24s %6d %8d %9.2f %12.1f %12.1f %12.1f %14d\n", format.name, (int) decoders.size(), (int) frames.size(), bytes / 1e6,
+			bytes / 1e6 / decode, frames.size() / decode, frames.size() / pipeline, (int) (after.allocations - before.allocations));
+	}
+
+	return 0;
+}
+
+int batchConvert(const QStringList & arguments)
+{
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Converts creatures sprites to .c32 files without opening a window.");
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption("convert", "Run the batch converter."));
+	parser.addOption(QCommandLineOption("benchmark", "Time every decoder and the import pipeline on the sprites instead of converting them."));
+	parser.addOption(QCommandLineOption("repeat", "Benchmark runs to take the best of (default 3).", "n", "3"));
+	parser.addOption(QCommandLineOption(QStringList() << "o" << "output", "Write the .c32 files to <directory> instead of next to the sprites.", "directory"));
+	parser.addOption(QCommandLineOption(QStringList() << "j" << "jobs", "Use <n> threads (default: all cores).", "n"));
+	parser.addOption(QCommandLineOption("passes", "Print how many reverse dithering passes each frame took."));
+	import_settings::addOptions(parser);
+	parser.addPositionalArgument("sprites", "Files, directories or wildcards of sprites (" + spriteFormatFilter() + ").", "<sprites...>");
+	parser.process(arguments);
+
+	const import_settings settings(parser);
+	QStringList inputs = expandInputs(parser.positionalArguments());
+
+	if(inputs.isEmpty())
+	{
+		parser.showHelp(1);
+	}
+
+	if(parser.isSet("jobs"))
+	{
+		QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value("jobs").toInt()));
+	}
+
+	if(parser.isSet("benchmark"))
+	{
+		return runBenchmark(inputs, settings, qMax(1, parser.value("repeat").toInt()));
+	}
+
+	QDir output_dir(parser.value("output"));
+	inputs.removeDuplicates();
+
+	QStringList outputs;
+	QMap<QString, QString> claimed;
+	bool clash = false;
+
+//sprites that only differ in their suffix would be written over each other, so nothing is converted until the names are sorted out
+	for(auto & input : inputs)
+	{
+		QFileInfo info(input);
+		outputs.push_back((parser.isSet("output")? output_dir : info.dir()).filePath(info.completeBaseName() + ".c32"));
+
+		QString path = QFileInfo(outputs.back()).absoluteFilePath();
+
+		if(claimed.contains(path))
+		{
+			fprintf(stderr, "'%s' and '%s' would both be written to '%s'.\n", qPrintable(claimed[path]), qPrintable(input), qPrintable(outputs.back()));
+			clash = true;
+		}
+		else
+		{
+			claimed.insert(path, input);
+		}
+	}
+
+	if(clash)
+	{
+		return 1;
+	}
+
+	if(parser.isSet("output") && !output_dir.exists() && !QDir().mkpath(output_dir.path()))
+	{
+		fprintf(stderr, "Unable to create directory '%s'.\n", qPrintable(output_dir.path()));
+		return 1;
+	}
+
+//files go through a few at a time, so a big batch doesn't hold every file's mapping and frames until the end
+	const int in_flight = 2 * QThreadPool::globalInstance()->maxThreadCount();
+	int failed = 0;
+
+	for(int first = 0; first < inputs.size(); first += in_flight)
+	{
+		std::vector<convert_file> files(qMin(in_flight, inputs.size() - first));
+
+		for(size_t i = 0; i < files.size(); ++i)
+		{
+			files[i].input = inputs[first + i];
+			files[i].output = outputs[first + i];
+		}
+
+		failed += convertFiles(files, settings, parser.isSet("passes"));
+	}
+
+	return failed? 1 : 0;
+}
@@ -0,0 +1,10 @@
+#ifndef BATCHCONVERT_H
+#define BATCHCONVERT_H
+#include <QStringList>
+
+//SpriteBuilder --convert [options] <sprites...> converts without opening a window,
+//SpriteBuilder --benchmark [options] <sprites...> times the decoders and the import pipeline instead
+bool isBatchConvert(int argc, char * argv[]);
+int batchConvert(const QStringList & arguments);
+
+#endif // BATCHCONVERT_H
@@ -0,0 +1,57 @@
+#include "framearena.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+static std::atomic<uint64_t> total_borrows(0);
+static std::atomic<uint64_t> total_allocations(0);
+static std::atomic<uint64_t> total_bytes(0);
+
+struct frame_arena
+{
+	frame_arena() :
+		capacity()
+	{
+	}
+
+	~frame_arena()
+	{
+		for(size_t i = 0; i < ARENA_SLOTS; ++i)
+		{
+			total_bytes -= capacity[i];
+		}
+	}
+
+	std::unique_ptr<uint64_t[]> buffer[ARENA_SLOTS];
+	size_t capacity[ARENA_SLOTS];
+};
+
+void * borrowScratch(arena_slot slot, size_t bytes)
+{
+	static thread_local frame_arena arena;
+
+	++total_borrows;
+
+	if(arena.capacity[slot] < bytes)
+	{
+//half again as much, so a file of slowly growing frames doesn't grow every time
+		size_t size = std::max(bytes, arena.capacity[slot] + arena.capacity[slot] / 2);
+		size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+		arena.buffer[slot].reset(new uint64_t[size / sizeof(uint64_t)]);
+		total_bytes += size - arena.capacity[slot];
+		arena.capacity[slot] = size;
+		++total_allocations;
+	}
+
+	return arena.buffer[slot].get();
+}
+
+arena_stats arenaStats()
+{
+	arena_stats stats;
+	stats.borrows = total_borrows;
+	stats.allocations = total_allocations;
+	stats.bytes = total_bytes;
+	return stats;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+#include <cstddef>
+#include <cstdint>
+
+//scratch memory for the import, filter, scale and save chain. every thread keeps one buffer per slot that
+//only ever grows, so once a thread has seen the largest frame it allocates nothing more.
+//a buffer is good until the same thread borrows the same slot again.
+enum arena_slot
+{
+	ARENA_PING,	//the pixels a filter pass reads while it writes the image
+	ARENA_PONG,	//the image before the first of several passes
+	ARENA_ALPHA,	//padded alpha plane
+	ARENA_ROW,	//one row of results
+	ARENA_STAMP,	//worklist stamps of the incremental passes
+	ARENA_CHANGED,	//pixels the last pass changed
+	ARENA_WRITES,	//a pass's new values, waiting to be applied
+	ARENA_PACKED,	//frames packed for squish, or a padded source packed for the scaler
+	ARENA_BLOCKS,	//compressed blocks
+	ARENA_TILES,	//tile occupancy map
+	ARENA_PLANES,	//planar channels for the scaler
+	ARENA_DIAGONALS,	//pixels the scaler's last pass is working through
+	ARENA_STAGES,	//the scaler's results between doublings
+	ARENA_SLOTS
+};
+
+struct arena_stats
+{
+	uint64_t borrows;
+//times a buffer had to grow, and the total bytes held
+	uint64_t allocations;
+	uint64_t bytes;
+};
+
+void * borrowScratch(arena_slot slot, size_t bytes);
+
+template<typename T>
+inline
+T * borrowScratch(arena_slot slot, size_t n)
+{
+	return static_cast<T*>(borrowScratch(slot, n * sizeof(T)));
+}
+
+//totals over every thread so far
+arena_stats arenaStats();
+
+#endif // FRAMEARENA_H
@@ -0,0 +1,54 @@
+#ifndef IMAGEBANDS_H
+#define IMAGEBANDS_H
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <algorithm>
+#include <vector>
+
+//rows [begin, end) of an image
+struct image_band
+{
+	int begin, end;
+	int result;
+};
+
+//splits height rows into horizontal bands of at least min_rows and runs f(begin, end) over them on the thread pool,
+//returning the sum of what f returns. small images stay on the calling thread.
+//
+//a 3x3 stencil reads one row past each end of its band (its halo) from the shared source and only writes its own rows
+//of the destination, so the bands of one pass never see each other's output; the only sync between passes is this
+//call returning.
+template<typename F>
+int forEachBand(int height, F f, int min_rows = 64)
+{
+	int n = std::max(1, std::min(QThreadPool::globalInstance()->maxThreadCount(), height / std::max(1, min_rows)));
+
+	if(n == 1)
+	{
+		return f(0, height);
+	}
+
+	std::vector<image_band> bands(n);
+
+	for(int i = 0; i < n; ++i)
+	{
+		bands[i].begin  = height *  i    / n;
+		bands[i].end    = height * (i+1) / n;
+		bands[i].result = 0;
+	}
+
+	QtConcurrent::blockingMap(bands, [&f](image_band & band)
+	{
+		band.result = f(band.begin, band.end);
+	});
+
+	int sum = 0;
+	for(auto & band : bands)
+	{
+		sum += band.result;
+	}
+
+	return sum;
+}
+
+#endif // IMAGEBANDS_H
@@ -1,4 +1,10 @@
 #include "imageview.h"
+#include "importpipeline.h"
+#include "imagebands.h"
+#include "linearlight.h"
+#include "framearena.h"
+#include "tilemap.h"
+#include <QtConcurrent>
 #include <QPainter>
 #include <QPaintEvent>
 #include <QTableWidget>
@@ -29,35 +35,57 @@ ImageView::ImageView(QTableWidget * table, int row, int col) :
 
 ImageView::~ImageView()
 {
+	if(pending)
+	{
+		pending->item = 0L;
+	}
+
 	deinitialize();
 }
 
 
-QRect calculateBoundingBox(const QImage & img)
+//transparent tiles are passed over and opaque ones taken whole, only the rest are looked at pixel by pixel
+QRect calculateBoundingBox(const QImage & img, const tile_map & tiles)
 {
 	int min_x = img.width(), min_y = img.height(), max_x = 0, max_y = 0;
 
-	for(int x = 0; x < img.width(); ++x)
+	for(int ty = 0; ty < tiles.rows; ++ty)
 	{
-		for(int y = 0; y < img.height(); ++y)
+		const int y0 = ty << TILE_SHIFT;
+		const int y1 = std::min(y0 + TILE_SIZE, img.height());
+
+		for(int tx = 0; tx < tiles.columns; ++tx)
 		{
-			if(qAlpha(img.pixel(x, y)) > 64)
+			const int x0 = tx << TILE_SHIFT;
+			const int x1 = std::min(x0 + TILE_SIZE, img.width());
+
+			if(tiles.at(tx, ty) & TILE_TRANSPARENT)
 			{
-				if(min_x > x)
-				{
-					min_x = x;
-				}
-				if(max_x < x)
-				{
-					max_x = x;
-				}
-				if(min_y > y)
-				{
-					min_y = y;
-				}
-				if(max_y < y)
+				continue;
+			}
+
+			if(tiles.at(tx, ty) & TILE_OPAQUE)
+			{
+				min_x = std::min(min_x, x0);
+				max_x = std::max(max_x, x1 - 1);
+				min_y = std::min(min_y, y0);
+				max_y = std::max(max_y, y1 - 1);
+				continue;
+			}
+
+			for(int y = y0; y < y1; ++y)
+			{
+				const QRgb * line = reinterpret_cast<const QRgb*>(img.constScanLine(y));
+
+				for(int x = x0; x < x1; ++x)
 				{
-					max_y = y;
+					if(qAlpha(line[x]) > 64)
+					{
+						min_x = std::min(min_x, x);
+						max_x = std::max(max_x, x);
+						min_y = std::min(min_y, y);
+						max_y = std::max(max_y, y);
+					}
 				}
 			}
 		}
@@ -66,62 +94,100 @@ QRect calculateBoundingBox(const QImage & img)
 	return QRect(min_x, min_y, max_x - min_x, max_y - min_y);
 }
 
-template<typename T>
-static inline
-T ALWAYS_INLINE sq(const T & t)
+QRect calculateBoundingBox(const QImage & img)
 {
-	return t*t;
-}
+	if(img.format() != QImage::Format_ARGB32
+	&& img.format() != QImage::Format_ARGB32_Premultiplied)
+	{
+		return calculateBoundingBox(img.convertToFormat(QImage::Format_ARGB32));
+	}
 
+	return calculateBoundingBox(img, buildTileMap(img));
+}
 
 void ImageView::setThumbnail()
 {
-	bounds = calculateBoundingBox(image);
+	const tile_map tiles = buildTileMap(image);
+	bounds = calculateBoundingBox(image, tiles);
+
 	QImage img = image;
 
-	for(int x = 0; x < image.width(); ++x)
+//setImage keeps the image in ARGB32_Premultiplied, where pixel() is just the stored word.
+//the bands write through the pointer, so detach first
+	const QImage & src = image;
+	uchar * bits = img.bits();
+	const int bytes_per_line = img.bytesPerLine();
+
+	forEachBand(src.height(), [&src, &tiles, bits, bytes_per_line](int begin, int end)
 	{
-		for(int y = 0; y < image.height(); ++y)
+		for(int y = begin; y < end; ++y)
 		{
-			auto p = image.pixel(x, y);
-			int alpha = qAlpha(p);
-
-			if(alpha == 255) continue;
+			const QRgb * line = reinterpret_cast<const QRgb*>(src.constScanLine(y));
+			QRgb * out = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
 
-			auto color = 0xFF;
-			if(((x / 8 + 1) & 0x01) ^ ((y / 8 + 1) & 0x01))
+			for(int x = 0; x < src.width(); ++x)
 			{
-				color = 0xCC;
-			}
+//opaque tiles stay as they are and transparent ones are just the checkerboard, whose squares are the tiles
+				if((x & (TILE_SIZE - 1)) == 0)
+				{
+					const uint8_t tile = tiles.at(x >> TILE_SHIFT, y >> TILE_SHIFT);
+					const int end_x = std::min(x + TILE_SIZE, src.width());
+
+					if(tile & TILE_TRANSPARENT)
+					{
+						const int color = (((x / 8 + 1) & 0x01) ^ ((y / 8 + 1) & 0x01))? 0xCC : 0xFF;
+						std::fill(out + x, out + end_x, qRgba(color, color, color, 0xFF));
+					}
+
+					if(tile & (TILE_TRANSPARENT | TILE_OPAQUE))
+					{
+						x = end_x - 1;
+						continue;
+					}
+				}
+
+				auto p = line[x];
+				int alpha = qAlpha(p);
+
+				if(alpha == 255) continue;
+
+				auto color = 0xFF;
+				if(((x / 8 + 1) & 0x01) ^ ((y / 8 + 1) & 0x01))
+				{
+					color = 0xCC;
+				}
 
-			auto a = alpha/255.0;
-#define blend(ca, aa, cb, ab) (ca*aa + cb*ab * (1-aa)) / (aa + ab*(1 - aa))
+//composited over the checkerboard in integers, the #if 0 version does it in linear light
 #if 0
-			img.setPixel(x, y, qRgba(
-				sqrt(blend(sq(qRed  (p)), a, sq(color), 1.0)),
-				sqrt(blend(sq(qGreen(p)), a, sq(color), 1.0)),
-				sqrt(blend(sq(qBlue (p)), a, sq(color), 1.0)),
-				0xFF
-			)
-			);
+				const linear_tables & lt = linearTables();
+#define blend(c) lt.encode((lt.linear[c] * alpha + lt.linear[color] * (255 - alpha)) / 255)
 #else
-			img.setPixel(x, y, qRgba(
-				blend(qRed  (p), a, color, 1.0),
-				blend(qGreen(p), a, color, 1.0),
-				blend(qBlue (p), a, color, 1.0),
-				0xFF
-			)
-			);
+#define blend(c) ((c) * alpha + color * (255 - alpha)) / 255
 #endif
+				out[x] = qRgba(
+					blend(qRed  (p)),
+					blend(qGreen(p)),
+					blend(qBlue (p)),
+					0xFF
+				);
 #undef blend
+			}
 		}
-	}
+
+		return 0;
+	});
 
 	setData(Qt::DecorationRole, QPixmap::fromImage(img));
 }
 
-bool ImageView::setImage(QImage img)
+bool ImageView::setImage(QImage img, bool thumbnail)
 {
+	if(pending)
+	{
+		pending->item = 0L;
+		pending.clear();
+	}
+
 	if(img.isNull())
 	{
 		image = img;
@@ -132,11 +198,55 @@ bool ImageView::setImage(QImage img)
 	image = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
 	bounds = calculateBoundingBox(image);
 
-	setThumbnail();
+	if(thumbnail)
+	{
+		setThumbnail();
+	}
 
 	return true;
 }
 
+void ImageView::setPending(const QSharedPointer<const import_source> & source, const import_job & job)
+{
+	pending.reset(new pending_frame(source, job));
+	pending->item = this;
+	image = QImage();
+	bounds = QRect();
+
+	setData(Qt::SizeHintRole, importedSize(job, source->settings));
+}
+
+void ImageView::prefetch()
+{
+	if(!pending || pending->queued)
+	{
+		return;
+	}
+
+//the job keeps the frame alive if the item is deleted before it runs
+	auto frame = pending;
+	frame->queued = true;
+	QtConcurrent::run([frame]()
+	{
+		frame->decode();
+	});
+}
+
+void ImageView::load()
+{
+	if(!pending)
+	{
+		return;
+	}
+
+//waits if a worker is on it already, otherwise decodes it here
+	auto frame = pending;
+	frame->decode();
+
+	setData(Qt::SizeHintRole, QVariant());
+	setImage(frame->job.image);
+	frame->job.image = QImage();
+}
 
 uint32_t ImageView::getRunLength(int i, bool transparent)
 {
@@ -186,7 +296,7 @@ struct BLOCK_64
 	}
 };
 
-void writeDtx1(FILE * file, std::vector<uint32_t> & uncompressed_image, int width, int height)
+void writeDtx1(FILE * file, uint32_t * uncompressed_image, int width, int height)
 {
 	uint32_t size = GetStorageRequirements(width, height, squish::kDxt1);
 
@@ -196,30 +306,31 @@ void writeDtx1(FILE * file, std::vector<uint32_t> & uncompressed_image, int widt
 		fwrite(&size, 4, 1, file);
 	}
 
-	std::vector<BLOCK_64> blocks(size >> 3);
-	squish::CompressImage((uint8_t*) uncompressed_image.data(), width, height, (void*) blocks.data(),
+	const size_t no_blocks = size >> 3;
+	BLOCK_64 * blocks = borrowScratch<BLOCK_64>(ARENA_BLOCKS, no_blocks);
+	squish::CompressImage((uint8_t*) uncompressed_image, width, height, (void*) blocks,
 		squish::kDxt1);
 #if 0
 	uint32_t length = 0;
 	fwrite(&length, 4, 1, file);
 	fwrite(&size, 4, 1, file);
-	fwrite(blocks.data(), 8, blocks.size(), file);
+	fwrite(blocks, 8, no_blocks, file);
 #else
-	for(size_t i = 0; i < blocks.size(); )
+	for(size_t i = 0; i < no_blocks; )
 	{
 		uint32_t length;
-		for(length = 0; i < blocks.size() && !blocks[i]; ++i, ++length) {}
+		for(length = 0; i < no_blocks && !blocks[i]; ++i, ++length) {}
 
 		length <<= 3;
 		length = byte_swap(length);
 		fwrite(&length, 4, 1, file);
 
-		if(i >= size)
+		if(i >= no_blocks)
 		{
 			break;
 		}
 
-		for(length = 0; i+length < blocks.size() && blocks[i+length]; ++length)  {}
+		for(length = 0; i+length < no_blocks && blocks[i+length]; ++length)  {}
 
 		{
 			uint32_t len = length << 3;
@@ -227,7 +338,7 @@ void writeDtx1(FILE * file, std::vector<uint32_t> & uncompressed_image, int widt
 			fwrite(&len, 4, 1, file);
 		}
 
-		fwrite(blocks.data() + i, 8, length, file);
+		fwrite(blocks + i, 8, length, file);
 		i += length;
 	}
 #endif
@@ -266,7 +377,8 @@ void ImageView::writeImage(FILE * file)
 {
 	uint32_t size = image.width()*image.height();
 
-	std::vector<uint32_t> uncompressed_image(size, 0);
+	uint32_t * uncompressed_image = borrowScratch<uint32_t>(ARENA_PACKED, size);
+	memset(uncompressed_image, 0, size * sizeof(uint32_t));
 
 	uint16_t compression_1 = 0;
 	uint16_t compression_3 = 0;
@@ -346,8 +458,10 @@ void ImageView::writeImage(FILE * file)
 		fwrite(&length, 4, 1, file);
 	}
 
-	std::vector<BLOCK_128> blocks(size);
-	squish::CompressImage((uint8_t*) uncompressed_image.data(), image.width(), image.height(), (void*) blocks.data(),
+//one block per byte of output, the ones squish doesn't fill stay empty and end the file in a single skip
+	BLOCK_128 * blocks = borrowScratch<BLOCK_128>(ARENA_BLOCKS, size);
+	memset(blocks, 0, size * sizeof(BLOCK_128));
+	squish::CompressImage((uint8_t*) uncompressed_image, image.width(), image.height(), (void*) blocks,
 		compression_type | squish::kColourIterativeClusterFit | squish::kWeightColourByAlpha );
 
 	for(size_t i = 0; i < size; )
@@ -372,12 +486,12 @@ void ImageView::writeImage(FILE * file)
 			fwrite(&len, 4, 1, file);
 		}
 
-		fwrite(blocks.data() + i, 16, length, file);
+		fwrite(blocks + i, 16, length, file);
 		i += length;
 	}
 }
 
-void ImageView::readImage(FILE * file, short w, short h)
+void ImageView::readImage(FILE * file, short w, short h, bool thumbnail)
 {
 	uint8_t compression_type;
 	fread(&compression_type, 1, 1, file);
@@ -461,7 +575,14 @@ void ImageView::readImage(FILE * file, short w, short h)
 		image.setPixel(i % w, i / w, c);
 	}
 
-	setThumbnail();
+	if(thumbnail)
+	{
+		setThumbnail();
+	}
+	else
+	{
+		bounds = calculateBoundingBox(image);
+	}
 }
 
 void ImageView::initialize(QTableWidget *table)
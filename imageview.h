@@ -4,7 +4,12 @@
 #include <QPoint>
 #include <QTableWidgetItem>
 
+#define BAKED_IMAGE_SLOT 0
+
 class QTableWidget;
+struct import_job;
+struct import_source;
+struct pending_frame;
 
 class ImageView : public QTableWidgetItem
 {
@@ -12,6 +17,8 @@ typedef QTableWidgetItem super;
 	const int row, column;
 
 	std::vector<ImageView *> map;
+	QSharedPointer<pending_frame> pending;
+
 	uint32_t getRunLength(int i, bool transparent);
 
 public:
@@ -24,9 +31,16 @@ public:
 
 	void setThumbnail();
 
-	bool setImage(QImage img);
+	bool setImage(QImage img, bool thumbnail = true);
+
+//the frame is only decoded by load(), until then the item is an empty placeholder of the final size
+	void setPending(const QSharedPointer<const import_source> & source, const import_job & job);
+	bool isLoaded() const { return pending.isNull(); }
+	const QSharedPointer<pending_frame> & pendingFrame() const { return pending; }
+	void prefetch();
+	void load();
 
-	void readImage(FILE * file, short w, short h);
+	void readImage(FILE * file, short w, short h, bool thumbnail = true);
 	void writeImage(FILE *file);
 
 	void initialize(QTableWidget *table);
@@ -0,0 +1,514 @@
+#include "importpipeline.h"
+#include "importsettings.h"
+#include "spritedecoder.h"
+#include "reversedither.h"
+#include <QFileInfo>
+#include <QRegExp>
+
+QImage scale_image(QImage image, int factor, bool fixed);
+
+const static QRegExp validator("^[a-z][0-9]{2}(([a-z].[cs]16)|([0-9].spr))", Qt::CaseInsensitive);
+
+char getPartNumber(char part)
+{
+	switch(tolower(part))
+	{
+	default: return 0;
+	case 'c':
+	case 'f': return 1;
+	case 'd':
+	case 'g': return 2;
+	case 'e':
+	case 'h': return 2;
+
+	case 'i':
+	case 'k': return 1;
+
+	case 'j':
+	case 'l': return 0;
+
+//tail sort of necessarily has to match body
+	case 'm':
+	case 'n':
+	case 'b': return 2;
+
+//ears/hair match head
+	case 'o':
+	case 'p':
+	case 'q':
+	case 'a': return 1;
+		return 0;
+	}
+
+}
+
+struct creature_sprite
+{
+	explicit creature_sprite(const QString & filename)
+	{
+		QString name = QFileInfo(filename).fileName();
+		is_creature_sprite = validator.exactMatch(name);
+		body_part = tolower(name.at(0).toLatin1());
+		part = getPartNumber(body_part);
+	}
+
+	bool is_creature_sprite;
+	char body_part;
+	uint8_t part;
+};
+
+static
+QSize frameSize(int width, int height, const import_settings & settings)
+{
+	return QSize(
+		settings.resize? ((width +1) & 0xFFFE) : ((width +3) & 0xFFFE),
+		settings.resize? ((height+1) & 0xFFFE) : ((height+3) & 0xFFFC));
+}
+
+QSize importedSize(const import_job & job, const import_settings & settings)
+{
+	QSize size = frameSize(job.width, job.height, settings);
+	return settings.resize? size*settings.resize_factor : size;
+}
+
+QImage allocateFrame(int width, int height, const import_settings & settings)
+{
+	QImage image(frameSize(width, height, settings), QImage::Format_ARGB32);
+
+	image.fill(0);
+	return image;
+}
+
+dither_passes processFrame(QImage & image, const import_settings & settings)
+{
+	dither_passes passes{ 0, 0 };
+
+	if(settings.reverse_dithering)
+	{
+//the fused passes all run together, so a convergence threshold needs them one after another
+		if(settings.fused_dithering && !settings.convergence)
+		{
+			passes = reverseDitherFused(image, settings.blur_iterations, settings.alpha_iterations);
+		}
+		else
+		{
+			passes = reverseDither(image, settings.blur_iterations, settings.alpha_iterations, settings.convergence);
+		}
+	}
+
+	if(settings.resize)
+	{
+		if(settings.resize_linear)
+		{
+			image = image.scaled(image.size()*settings.resize_factor, Qt::KeepAspectRatioByExpanding, Qt::FastTransformation);
+		}
+		else if(settings.resize_bilinear)
+		{
+			image = image.scaled(image.size()*settings.resize_factor, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+		}
+		else
+		{
+			image = scale_image(image, settings.resize_factor, settings.resize_fixed);
+		}
+	}
+
+	return passes;
+}
+
+bool runImportJob(import_job & job, const import_settings & settings, const std::function<bool (import_job &)> & decode)
+{
+	if(job.frame < 0)
+	{
+		return true;
+	}
+
+	job.image = allocateFrame(job.width, job.height, settings);
+
+	if(!decode(job))
+	{
+		job.image.fill(0);
+		job.done = true;
+		return false;
+	}
+
+	dither_passes passes = processFrame(job.image, settings);
+	job.color_passes = passes.colors;
+	job.alpha_passes = passes.alphas;
+	job.done = true;
+	return true;
+}
+
+pending_frame::pending_frame(const QSharedPointer<const import_source> & source, const import_job & job) :
+	source(source),
+	job(job),
+	item(0L),
+	queued(false)
+{
+}
+
+void pending_frame::decode()
+{
+	QMutexLocker lock(&mutex);
+
+	if(!job.done)
+	{
+		runImportJob(job, source->settings, source->decode);
+	}
+}
+
+std::vector<import_job> planC16Import(const SpriteDecoder & decoder, const QString & filename, const import_settings & settings)
+{
+	const creature_sprite sprite(filename);
+	const bool is_creature_sprite = sprite.is_creature_sprite;
+	const char body_part = sprite.body_part;
+	const uint8_t part = sprite.part;
+
+	int no_images = decoder.frameCount();
+
+	std::vector<import_job> jobs;
+	jobs.reserve(no_images);
+
+	for(int i = 0; i < no_images; ++i)
+	{
+		uint16_t width  = decoder.frameSize(i).width();
+		uint16_t height = decoder.frameSize(i).height();
+
+		if(is_creature_sprite)
+		{
+			if(settings.eliminate_unnecessary)
+			{
+//creatures 2 sprite
+				if(no_images == 120
+				|| no_images == 10)
+				{
+					int c = i % 10;
+
+					if(c != 8
+					&& c != 9
+					&& c != part
+					&& c != part+4)
+					{
+						continue;
+					}
+				}
+				else if(no_images % 16 == 0)
+				{
+					if(i % 4 != part)
+					{
+						continue;
+					}
+				}
+			}
+		}
+
+		jobs.push_back(import_job());
+
+		if(is_creature_sprite)
+		{
+			if(settings.bilaterally_symmetrical)
+			{
+				if(body_part == 'b'
+				|| body_part >= 'm'
+				|| body_part == 'a')
+				{
+					if(no_images % 16 == 0)
+					{
+						if(i % 16 < 4)
+						{
+							continue;
+						}
+					}
+					else if(no_images % 10 == 0)
+					{
+						if(i % 10 < 4)
+						{
+							continue;
+						}
+					}
+				}
+			}
+
+			if(settings.eliminate_reverse_blink)
+			{
+				if(body_part == 'a')
+				{
+					if(no_images == 120)
+					{
+						if(i % 20 == 19)
+						{
+							continue;
+						}
+					}
+					else
+					{
+						if(i % 32 >= 28)
+						{
+							continue;
+						}
+					}
+				}
+				else if(body_part == 'b' && no_images > 16)
+				{
+					if(i > 16 && i % 16 >= 12)
+					{
+						continue;
+					}
+				}
+			}
+
+		}
+
+		jobs.back() = import_job(i, width, height);
+	}
+
+	return jobs;
+}
+
+std::vector<import_job> planSprImport(const SpriteDecoder & decoder, const QString & filename, const import_settings & settings)
+{
+	const creature_sprite sprite(filename);
+	const bool is_creature_sprite = sprite.is_creature_sprite;
+	const char body_part = sprite.body_part;
+	const uint8_t part = sprite.part;
+
+	uint16_t no_images = decoder.frameCount();
+
+	std::vector<import_job> jobs;
+	jobs.reserve(no_images);
+
+	for(uint16_t i = 0; i < no_images; ++i)
+	{
+		if(is_creature_sprite
+		&& settings.eliminate_unnecessary)
+		{
+			int c = i % 13;
+
+			if(c < 8
+			&& c != part
+			&& c != part+4)
+			{
+				continue;
+			}
+		}
+
+		jobs.push_back(import_job());
+
+		if(is_creature_sprite)
+		{
+			if(settings.bilaterally_symmetrical)
+			{
+				if(body_part == 'b')
+				{
+					if(i % 10 < 4)
+					{
+						continue;
+					}
+				}
+				else if(body_part == 'a')
+				{
+					if(i % 13 < 4)
+					{
+						continue;
+					}
+				}
+			}
+
+			if(settings.eliminate_reverse_blink)
+			{
+				if(body_part == 'a')
+				{
+					if(i == 22)
+					{
+						continue;
+					}
+				}
+			}
+		}
+
+		jobs.back() = import_job(i, decoder.frameSize(i).width(), decoder.frameSize(i).height());
+	}
+
+	return jobs;
+}
+
+void reorderC16Import(std::vector<import_job> & jobs, const QString & filename, const import_settings & settings)
+{
+	if(!creature_sprite(filename).is_creature_sprite
+	|| !settings.eliminate_unnecessary
+	|| !settings.reorder_sprites)
+	{
+		return;
+	}
+
+//same as RearrangeCommand, a row whose partner is past the end is left empty
+	for(size_t i = 0; i < jobs.size(); i += 4)
+	{
+		for(size_t j = 0; j < 2; ++j)
+		{
+			size_t a = i + j;
+			size_t b = i + 3 - j;
+
+			if(a >= jobs.size())
+			{
+				break;
+			}
+
+			if(b < jobs.size())
+			{
+				std::swap(jobs[a], jobs[b]);
+			}
+			else
+			{
+				jobs[a] = import_job();
+			}
+		}
+	}
+}
+
+void reorderSprImport(std::vector<import_job> & jobs, const QString & filename, const import_settings & settings)
+{
+	const creature_sprite sprite(filename);
+
+	if(!sprite.is_creature_sprite
+	|| !settings.eliminate_unnecessary
+	|| !settings.reorder_sprites)
+	{
+		return;
+	}
+
+	if(sprite.body_part != 'a')
+	{
+		reorderC16Import(jobs, filename, settings);
+		return;
+	}
+
+//creatures 1 heads, spread out to the creatures 2 layout
+	static const int order[][2] =
+	{
+		{ 0,  3}, { 1,  2}, { 2,  1}, { 3,  0},
+		{ 4, 10}, { 5,  9}, { 6,  8}, { 7,  7},
+		{ 9,  4}, {13, 11},
+		{17,  5}, {21, 12},
+		{25,  6}, {29, 13}
+	};
+
+	std::vector<import_job> images;
+	images.swap(jobs);
+	jobs.resize(std::max<size_t>(images.size(), 32));
+
+	for(auto & o : order)
+	{
+		if(o[1] < (int) images.size())
+		{
+			jobs[o[0]] = images[o[1]];
+		}
+	}
+}
+
+template<class Decoder>
+static
+SpriteDecoder * createDecoder()
+{
+	return new Decoder;
+}
+
+static
+std::vector<sprite_format> & formatList()
+{
+	static std::vector<sprite_format> formats =
+	{
+		{ "Creatures 2 Sprite", "c16 s16", &createDecoder<C16Decoder>, &planC16Import, &reorderC16Import },
+		{ "Creatures 1 Sprite", "spr", &createDecoder<SprDecoder>, &planSprImport, &reorderSprImport }
+	};
+
+	return formats;
+}
+
+const std::vector<sprite_format> & spriteFormats()
+{
+	return formatList();
+}
+
+void registerSpriteFormat(const sprite_format & format)
+{
+	formatList().push_back(format);
+}
+
+const sprite_format * findSpriteFormat(const QString & filename)
+{
+	QString suffix = QFileInfo(filename).suffix().toLower();
+
+	for(auto & format : spriteFormats())
+	{
+		if(QString(format.suffixes).split(' ').contains(suffix))
+		{
+			return &format;
+		}
+	}
+
+	return 0L;
+}
+
+QString spriteFormatFilter(const sprite_format * format)
+{
+	QStringList wildcards;
+
+	for(auto & f : spriteFormats())
+	{
+		if(!format || format == &f)
+		{
+			for(auto & suffix : QString(f.suffixes).split(' '))
+			{
+				wildcards << QString("*.%1").arg(suffix);
+			}
+		}
+	}
+
+	return QString("%1 (%2)").arg(format? format->name : "Sprites", wildcards.join(' '));
+}
+
+QSharedPointer<SpriteDecoder> openSprite(const QString & filename, const sprite_format ** format, SpriteDecoder::Status * status)
+{
+	*format = 0L;
+	*status = SpriteDecoder::Unreadable;
+
+	const sprite_format * by_suffix = findSpriteFormat(filename);
+
+//a file with an unknown suffix goes to whichever format accepts its header
+	for(auto & f : spriteFormats())
+	{
+		if(by_suffix && by_suffix != &f)
+		{
+			continue;
+		}
+
+		QSharedPointer<SpriteDecoder> decoder(f.create());
+		SpriteDecoder::Status s = decoder->open(filename);
+
+		if(s == SpriteDecoder::Okay)
+		{
+			*format = &f;
+			*status = s;
+			return decoder;
+		}
+
+		if(*status != SpriteDecoder::Corrupt)
+		{
+			*status = s;
+		}
+	}
+
+	return QSharedPointer<SpriteDecoder>();
+}
+
+QSharedPointer<const import_source> planImport(const QSharedPointer<SpriteDecoder> & decoder, const sprite_format & format,
+	const QString & filename, const import_settings & settings, std::vector<import_job> & jobs)
+{
+	jobs = format.plan(*decoder, filename, settings);
+	format.reorder(jobs, filename, settings);
+
+	return QSharedPointer<const import_source>(new import_source(settings, [decoder](import_job & job)
+	{
+		return decoder->decodeFrame(job.frame, job.image);
+	}));
+}
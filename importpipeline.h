@@ -0,0 +1,114 @@
+#ifndef IMPORTPIPELINE_H
+#define IMPORTPIPELINE_H
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <functional>
+#include <vector>
+#include "importsettings.h"
+#include "spritedecoder.h"
+#include "reversedither.h"
+
+class QString;
+class ImageView;
+
+//one row of an import, in file order
+struct import_job
+{
+	explicit import_job(int frame = -1, int width = 0, int height = 0) :
+		frame(frame),
+		width(width),
+		height(height),
+		color_passes(0),
+		alpha_passes(0),
+		done(frame < 0)
+	{
+	}
+
+//-1 leaves the row empty
+	int frame;
+	int width, height;
+
+	QImage image;
+//reverse dithering passes the frame took
+	int color_passes, alpha_passes;
+	bool done;
+};
+
+//which frames become rows depends on the creature import options
+std::vector<import_job> planC16Import(const SpriteDecoder & decoder, const QString & filename, const import_settings & settings);
+std::vector<import_job> planSprImport(const SpriteDecoder & decoder, const QString & filename, const import_settings & settings);
+
+//puts the rows of a pruned creature sprite into rotation order
+void reorderC16Import(std::vector<import_job> & jobs, const QString & filename, const import_settings & settings);
+void reorderSprImport(std::vector<import_job> & jobs, const QString & filename, const import_settings & settings);
+
+//what a lazily imported table needs to decode its rows later, shared by all of them
+struct import_source
+{
+	import_source(const import_settings & settings, const std::function<bool (import_job &)> & decode) :
+		settings(settings),
+		decode(decode)
+	{
+	}
+
+	const import_settings settings;
+//false if the file is damaged and the frame couldn't be read
+	const std::function<bool (import_job &)> decode;
+};
+
+//a row that hasn't been decoded yet, decode() can be called from any thread and only does the work once.
+struct pending_frame
+{
+	pending_frame(const QSharedPointer<const import_source> & source, const import_job & job);
+
+	void decode();
+
+	QSharedPointer<const import_source> source;
+	import_job job;
+	QMutex mutex;
+
+//gui thread only, the item still waiting for the frame (if any) and whether it was handed to the thread pool
+	ImageView * item;
+	bool queued;
+};
+
+//size of the frame once it has been processed
+QSize importedSize(const import_job & job, const import_settings & settings);
+
+QImage allocateFrame(int width, int height, const import_settings & settings);
+//returns the reverse dithering passes it ran
+dither_passes processFrame(QImage & image, const import_settings & settings);
+
+//returns false if the frame couldn't be decoded, it is left blank and isn't processed
+bool runImportJob(import_job & job, const import_settings & settings, const std::function<bool (import_job &)> & decode);
+
+//a sprite format the importers, the batch converter and the benchmark know about,
+//new formats only need a decoder and a way to pick and order their frames.
+struct sprite_format
+{
+	const char * name;
+//space separated, lower case
+	const char * suffixes;
+
+	SpriteDecoder * (*create)();
+	std::vector<import_job> (*plan)(const SpriteDecoder & decoder, const QString & filename, const import_settings & settings);
+	void (*reorder)(std::vector<import_job> & jobs, const QString & filename, const import_settings & settings);
+};
+
+const std::vector<sprite_format> & spriteFormats();
+//only before any import starts
+void registerSpriteFormat(const sprite_format & format);
+
+const sprite_format * findSpriteFormat(const QString & filename);
+//file dialog filter for one format, or for all of them
+QString spriteFormatFilter(const sprite_format * format = 0L);
+
+//opens the file with the format its suffix names, or any format that accepts it if the suffix is unknown.
+QSharedPointer<SpriteDecoder> openSprite(const QString & filename, const sprite_format ** format, SpriteDecoder::Status * status);
+
+//picks and orders the rows, the returned source decodes them from any thread.
+QSharedPointer<const import_source> planImport(const QSharedPointer<SpriteDecoder> & decoder, const sprite_format & format,
+	const QString & filename, const import_settings & settings, std::vector<import_job> & jobs);
+
+#endif // IMPORTPIPELINE_H
@@ -1,5 +1,6 @@
 #include "importsettings.h"
 #include "ui_importsettings.h"
+#include <QCommandLineParser>
 
 import_settings::import_settings()
 {
@@ -12,6 +13,49 @@ import_settings::import_settings()
 	import_time = 1;
 }
 
+import_settings::import_settings(const QCommandLineParser & parser)
+{
+	memset(this, 0, sizeof(import_settings));
+
+	blur_iterations		= qBound(0, parser.value("color-iterations").toInt(), 15);
+	alpha_iterations	= qBound(0, parser.value("alpha-iterations").toInt(), 15);
+	reverse_dithering	= parser.isSet("dither");
+	fused_dithering		= parser.isSet("fused-dither");
+	convergence			= qBound(0.0, parser.value("convergence").toDouble(), 1.0);
+
+	QString resize_mode = parser.value("resize").toLower();
+	resize				= resize_mode != "none";
+	resize_linear		= resize_mode == "nearest";
+	resize_bilinear		= resize_mode == "bilinear";
+	resize_xbr			= resize && !resize_linear && !resize_bilinear;
+	resize_fixed		= resize_mode == "xbr-fixed";
+	int scale			= parser.value("scale").toInt();
+	resize_factor		= scale >= 8? 8 : scale >= 4? 4 : 2;
+
+	eliminate_unnecessary	= !parser.isSet("keep-rotations");
+	reorder_sprites			= !parser.isSet("keep-order");
+	bilaterally_symmetrical	= !parser.isSet("asymmetrical");
+	eliminate_reverse_blink	= !parser.isSet("keep-blinking");
+
+	accepted = true;
+	import_time = 1;
+}
+
+void import_settings::addOptions(QCommandLineParser & parser)
+{
+	parser.addOption(QCommandLineOption("dither", "Reverse transparency dithering."));
+	parser.addOption(QCommandLineOption("color-iterations", "Color interpolation iterations (default 4).", "n", "4"));
+	parser.addOption(QCommandLineOption("alpha-iterations", "Alpha interpolation iterations (default 3).", "n", "3"));
+	parser.addOption(QCommandLineOption("fused-dither", "Run all the dithering iterations in one sweep over the rows."));
+	parser.addOption(QCommandLineOption("convergence", "Stop dithering a frame once an iteration changes less than <fraction> of its pixels (default 0, only when nothing changes).", "fraction", "0"));
+	parser.addOption(QCommandLineOption("resize", "Resize for high dpi monitors: none, nearest, bilinear, xbr (default) or xbr-fixed, which comes out the same on every machine.", "mode", "xbr"));
+	parser.addOption(QCommandLineOption("scale", "How much to resize by: 2 (default), 4 or 8.", "factor", "2"));
+	parser.addOption(QCommandLineOption("keep-rotations", "Keep unnecessary rotations of creature sprites."));
+	parser.addOption(QCommandLineOption("keep-order", "Don't reorder part rotations."));
+	parser.addOption(QCommandLineOption("asymmetrical", "Don't treat creature parts as bilaterally symmetrical."));
+	parser.addOption(QCommandLineOption("keep-blinking", "Keep reverse blinking sprites."));
+}
+
 ImportSettings::ImportSettings(QWidget *parent, import_settings & set) :
 QDialog(parent),
 set(set),
@@ -29,6 +73,8 @@ ImportSettings::~ImportSettings()
 	set.resize_linear		= ui->nearest->isChecked();
 	set.resize_bilinear		= ui->Bilinear->isChecked();
 	set.resize_xbr			= ui->SuperXbr->isChecked();
+	set.resize_factor		= 2;
+	set.lazy_decoding		= ui->lazy->isChecked();
 
 	set.eliminate_unnecessary	= ui->eliminate->isChecked();
 	set.reorder_sprites			= ui->reorder->isChecked();
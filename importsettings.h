@@ -7,25 +7,39 @@ namespace Ui {
 class ImportSettings;
 }
 
+class QCommandLineParser;
+
 struct import_settings
 {
+//asks the user
 	import_settings();
+//for the batch converter, defaults match the dialog
+	explicit import_settings(const QCommandLineParser & parser);
+	static void addOptions(QCommandLineParser & parser);
 
 	uint8_t import_time;
 	unsigned blur_iterations : 4;
 	unsigned alpha_iterations : 4;
+//a filter stops early once a pass changes less than this fraction of the frame
+	float convergence;
+//2, 4 or 8 when resizing, xbr does it as that many doublings
+	uint8_t resize_factor;
 
 	bool reverse_dithering : 1;
+	bool fused_dithering : 1;
 	bool resize : 1;
 	bool resize_linear : 1;
 	bool resize_bilinear : 1;
 	bool resize_xbr : 1;
+	bool resize_fixed : 1;
 
 	bool eliminate_unnecessary : 1;
 	bool reorder_sprites : 1;
 	bool bilaterally_symmetrical : 1;
 	bool eliminate_reverse_blink: 1;
 
+	bool lazy_decoding : 1;
+
 	bool accepted : 1;
 };
 
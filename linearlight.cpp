@@ -0,0 +1,31 @@
+#include "linearlight.h"
+
+static
+linear_tables * buildTables()
+{
+	static linear_tables tables;
+
+	for(int c = 0; c < 256; ++c)
+	{
+		tables.linear[c] = c*c;
+	}
+
+//every value from c² up to (c+1)² - 1 has c as its root
+	for(int c = 0, v = 0; v < 65536; ++v)
+	{
+		while(c < 255 && (c+1)*(c+1) <= v)
+		{
+			++c;
+		}
+
+		tables.root[v] = c;
+	}
+
+	return &tables;
+}
+
+const linear_tables & linearTables()
+{
+	static const linear_tables * tables = buildTables();
+	return *tables;
+}
@@ -0,0 +1,25 @@
+#ifndef LINEARLIGHT_H
+#define LINEARLIGHT_H
+#include <cstdint>
+#include <cmath>
+
+//the color filters average in linear light, taken as the square of the 8 bit value (a gamma of 2).
+//16 bits hold every square exactly, and going back rounds down the way (int) sqrt() always did,
+//so a color that goes through both tables comes back unchanged.
+struct linear_tables
+{
+	uint16_t linear[256];
+	uint8_t  root[65536];
+
+//averages can go past a single color's range when the hidden colors of transparent pixels are in the sum,
+//those few take the slow way. callers mask the result to 8 bits as before.
+	int encode(uint32_t v) const
+	{
+		return v < 65536? root[v] : (int) sqrt((double) v);
+	}
+};
+
+//built on first use
+const linear_tables & linearTables();
+
+#endif // LINEARLIGHT_H
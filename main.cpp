@@ -1,8 +1,15 @@
 #include "spritebuilder.h"
+#include "batchconvert.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+	if(isBatchConvert(argc, argv))
+	{
+		QCoreApplication a(argc, argv);
+		return batchConvert(a.arguments());
+	}
+
 	QApplication a(argc, argv);
 	SpriteBuilder w;
 	w.show();
@@ -137,7 +137,7 @@ bool SpriteTable::editCopy()
 		return false;
 	}
 
-	ImageView * img = dynamic_cast<ImageView*>(item(currentRow(), currentColumn()));
+	ImageView * img = imageAt(currentRow(), currentColumn());
 
 	if(!img)
 	{
@@ -186,7 +186,7 @@ bool SpriteTable::editImport()
 
 bool SpriteTable::editExport()
 {
-	ImageView * img = dynamic_cast<ImageView*>(item(currentRow(), currentColumn()));
+	ImageView * img = imageAt(currentRow(), currentColumn());
 	if(!img || img->image.isNull())
 	{
 		return false;
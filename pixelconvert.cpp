@@ -0,0 +1,245 @@
+#include "pixelconvert.h"
+#include "byteswap.h"
+#include "simd.h"
+
+typedef void (*span_fn)(const uchar * src, QRgb * dst, int n);
+typedef void (*index_fn)(const uchar * src, QRgb * dst, int n, const QRgb * palette);
+
+template<bool _565, bool keyed>
+static inline
+QRgb ALWAYS_INLINE convertPixel(uint16_t c)
+{
+	if(keyed && !c)
+	{
+		return 0;
+	}
+
+	if(_565)
+	{
+		return 0xFF000000 | (c & 0xF800) << 8 | (c & 0x07E0) << 5 | (c & 0x001F) << 3;
+	}
+
+	return 0xFF000000 | (c & 0x7C00) << 9 | (c & 0x03E0) << 6 | (c & 0x001F) << 3;
+}
+
+template<bool _565, bool keyed>
+static
+void convertScalar(const uchar * src, QRgb * dst, int n)
+{
+	for(int i = 0; i < n; ++i, src += 2)
+	{
+		uint16_t c;
+		memcpy(&c, src, 2);
+		dst[i] = convertPixel<_565, keyed>(byte_swap(c));
+	}
+}
+
+static
+void expandScalar(const uchar * src, QRgb * dst, int n, const QRgb * palette)
+{
+	for(int i = 0; i < n; ++i)
+	{
+		QRgb c = palette[src[i]];
+
+		if(c)
+		{
+			dst[i] = c;
+		}
+	}
+}
+
+#if HAVE_X86_SIMD
+
+template<bool _565, bool keyed>
+static inline
+__m128i TARGET("sse2") ALWAYS_INLINE convert4(__m128i v)
+{
+	__m128i r, g;
+
+	if(_565)
+	{
+		r = _mm_and_si128(_mm_slli_epi32(v, 8), _mm_set1_epi32(0x00F80000));
+		g = _mm_and_si128(_mm_slli_epi32(v, 5), _mm_set1_epi32(0x0000FC00));
+	}
+	else
+	{
+		r = _mm_and_si128(_mm_slli_epi32(v, 9), _mm_set1_epi32(0x00F80000));
+		g = _mm_and_si128(_mm_slli_epi32(v, 6), _mm_set1_epi32(0x0000F800));
+	}
+
+	__m128i b = _mm_and_si128(_mm_slli_epi32(v, 3), _mm_set1_epi32(0x000000F8));
+	__m128i c = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32(0xFF000000)));
+
+	if(keyed)
+	{
+		c = _mm_andnot_si128(_mm_cmpeq_epi32(v, _mm_setzero_si128()), c);
+	}
+
+	return c;
+}
+
+template<bool _565, bool keyed>
+static
+void TARGET("sse2") convertSse2(const uchar * src, QRgb * dst, int n)
+{
+	int i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + i*2));
+		__m128i lo = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+		__m128i hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+
+		_mm_storeu_si128((__m128i *) (dst + i), convert4<_565, keyed>(lo));
+		_mm_storeu_si128((__m128i *) (dst + i + 4), convert4<_565, keyed>(hi));
+	}
+
+	convertScalar<_565, keyed>(src + i*2, dst + i, n - i);
+}
+
+template<bool _565, bool keyed>
+static inline
+__m256i TARGET("avx2") ALWAYS_INLINE convert8(__m256i v)
+{
+	__m256i r, g;
+
+	if(_565)
+	{
+		r = _mm256_and_si256(_mm256_slli_epi32(v, 8), _mm256_set1_epi32(0x00F80000));
+		g = _mm256_and_si256(_mm256_slli_epi32(v, 5), _mm256_set1_epi32(0x0000FC00));
+	}
+	else
+	{
+		r = _mm256_and_si256(_mm256_slli_epi32(v, 9), _mm256_set1_epi32(0x00F80000));
+		g = _mm256_and_si256(_mm256_slli_epi32(v, 6), _mm256_set1_epi32(0x0000F800));
+	}
+
+	__m256i b = _mm256_and_si256(_mm256_slli_epi32(v, 3), _mm256_set1_epi32(0x000000F8));
+	__m256i c = _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_set1_epi32(0xFF000000)));
+
+	if(keyed)
+	{
+		c = _mm256_andnot_si256(_mm256_cmpeq_epi32(v, _mm256_setzero_si256()), c);
+	}
+
+	return c;
+}
+
+template<bool _565, bool keyed>
+static
+void TARGET("avx2") convertAvx2(const uchar * src, QRgb * dst, int n)
+{
+	int i = 0;
+	for(; i + 16 <= n; i += 16)
+	{
+		__m128i lo = _mm_loadu_si128((const __m128i *) (src + i*2));
+		__m128i hi = _mm_loadu_si128((const __m128i *) (src + i*2 + 16));
+
+		_mm256_storeu_si256((__m256i *) (dst + i), convert8<_565, keyed>(_mm256_cvtepu16_epi32(lo)));
+		_mm256_storeu_si256((__m256i *) (dst + i + 8), convert8<_565, keyed>(_mm256_cvtepu16_epi32(hi)));
+	}
+
+	convertSse2<_565, keyed>(src + i*2, dst + i, n - i);
+}
+
+static
+void TARGET("avx2") expandAvx2(const uchar * src, QRgb * dst, int n, const QRgb * palette)
+{
+	int i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (src + i)));
+		__m256i color = _mm256_i32gather_epi32((const int *) palette, index, 4);
+		__m256i clear = _mm256_cmpeq_epi32(color, _mm256_setzero_si256());
+		__m256i old   = _mm256_loadu_si256((const __m256i *) (dst + i));
+
+		_mm256_storeu_si256((__m256i *) (dst + i), _mm256_blendv_epi8(color, old, clear));
+	}
+
+	expandScalar(src + i, dst + i, n - i, palette);
+}
+
+#endif
+
+struct span_kernels
+{
+	span_fn fn[2][2];
+
+	template<template<bool, bool> class K>
+	void assign()
+	{
+		fn[0][0] = &K<false, false>::run;
+		fn[0][1] = &K<false, true >::run;
+		fn[1][0] = &K<true,  false>::run;
+		fn[1][1] = &K<true,  true >::run;
+	}
+};
+
+template<bool _565, bool keyed> struct ScalarKernel { static void run(const uchar * s, QRgb * d, int n) { convertScalar<_565, keyed>(s, d, n); } };
+#if HAVE_X86_SIMD
+template<bool _565, bool keyed> struct Sse2Kernel { static void run(const uchar * s, QRgb * d, int n) { convertSse2<_565, keyed>(s, d, n); } };
+template<bool _565, bool keyed> struct Avx2Kernel { static void run(const uchar * s, QRgb * d, int n) { convertAvx2<_565, keyed>(s, d, n); } };
+#endif
+
+static
+const span_kernels & getKernels()
+{
+	static const span_kernels kernels = []()
+	{
+		span_kernels k;
+		k.assign<ScalarKernel>();
+
+#if HAVE_X86_SIMD
+//the simd paths load the file's little endian words directly
+		if(isLittleEndian())
+		{
+			switch(simdLevel())
+			{
+			case SIMD_AVX2:
+				k.assign<Avx2Kernel>();
+				break;
+			case SIMD_SSE2:
+				k.assign<Sse2Kernel>();
+				break;
+			default:
+				break;
+			}
+		}
+#endif
+
+		return k;
+	}();
+
+	return kernels;
+}
+
+void convertSpan(const uchar * src, QRgb * dst, int n, bool _565, bool keyed)
+{
+	if(n > 0)
+	{
+		getKernels().fn[_565][keyed](src, dst, n);
+	}
+}
+
+//sse2 has no gather, a table lookup per pixel is as good as it gets there
+static
+index_fn getIndexKernel()
+{
+#if HAVE_X86_SIMD
+	if(simdLevel() == SIMD_AVX2)
+	{
+		return &expandAvx2;
+	}
+#endif
+
+	return &expandScalar;
+}
+
+void expandIndexed(const uchar * src, QRgb * dst, int n, const argb_palette & palette)
+{
+	static const index_fn kernel = getIndexKernel();
+
+	if(n > 0)
+	{
+		kernel(src, dst, n, palette.color);
+	}
+}
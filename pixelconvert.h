@@ -0,0 +1,35 @@
+#ifndef PIXELCONVERT_H
+#define PIXELCONVERT_H
+#include <QRgb>
+
+//converts n little endian 16 bit colors to opaque ARGB32, bit for bit the same as from565().
+//if keyed, a color of 0 is written as a transparent 0 pixel instead (s16 style).
+void convertSpan(const uchar * src, QRgb * dst, int n, bool _565, bool keyed = false);
+
+template<int... I> struct index_list {};
+template<int N, int... I> struct make_index_list : make_index_list<N-1, N-1, I...> {};
+template<int... I> struct make_index_list<0, I...> { typedef index_list<I...> type; };
+
+//ARGB32 colors of an 8 bit indexed format, an entry of 0 is transparent
+struct argb_palette
+{
+	QRgb color[256];
+};
+
+//builds the table at compile time from a constexpr function of the index
+template<QRgb (*F)(int), int... I>
+constexpr argb_palette makePalette(index_list<I...>)
+{
+	return argb_palette{{ F(I)... }};
+}
+
+template<QRgb (*F)(int)>
+constexpr argb_palette makePalette()
+{
+	return makePalette<F>(make_index_list<256>::type());
+}
+
+//looks n 8 bit indices up in the palette, transparent entries leave dst as it was.
+void expandIndexed(const uchar * src, QRgb * dst, int n, const argb_palette & palette);
+
+#endif // PIXELCONVERT_H
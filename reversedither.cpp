@@ -0,0 +1,1022 @@
+#include "reversedither.h"
+#include "byteswap.h"
+#include "simd.h"
+#include "imagebands.h"
+#include "linearlight.h"
+#include "framearena.h"
+#include "tilemap.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+//the 3x3 neighborhoods are stored a column at a time, c[4] is the pixel itself
+//	0 3 6
+//	1 4 7
+//	2 5 8
+
+static inline
+const QRgb * ALWAYS_INLINE constLine(const QImage & image, int y)
+{
+	return reinterpret_cast<const QRgb*>(image.constScanLine(y));
+}
+
+//the rows a pass reads from, an image's own or a scratch copy of them.
+//a ring of a few lines has a mask of its size - 1, row y is kept in line y & mask.
+struct pixel_rows
+{
+	pixel_rows(const uchar * bits, int bytes_per_line, int w, int h, int mask = -1) :
+		bits(bits),
+		bytes_per_line(bytes_per_line),
+		mask(mask),
+		w(w),
+		h(h)
+	{
+	}
+
+	pixel_rows(const uchar * bits, const QImage & image) :
+		pixel_rows(bits, image.bytesPerLine(), image.width(), image.height())
+	{
+	}
+
+	explicit pixel_rows(const QImage & image) :
+		pixel_rows(image.constBits(), image)
+	{
+	}
+
+	int width() const { return w; }
+	int height() const { return h; }
+	const QRgb * line(int y) const { return reinterpret_cast<const QRgb*>(bits + (y & mask) * bytes_per_line); }
+
+	const uchar * bits;
+	int bytes_per_line;
+	int mask;
+	int w, h;
+};
+
+static inline
+const QRgb * ALWAYS_INLINE constLine(const pixel_rows & rows, int y)
+{
+	return rows.line(y);
+}
+
+//the kernels work on the raw words, anything else is brought to ARGB32 first
+static
+bool prepareImage(QImage & image)
+{
+//without an alpha channel every pixel is solid and so are all its neighbors, no pass would change anything
+	if(image.isNull() || !image.hasAlphaChannel())
+	{
+		return false;
+	}
+
+	if(image.format() != QImage::Format_ARGB32
+	&& image.format() != QImage::Format_ARGB32_Premultiplied)
+	{
+		image = image.convertToFormat(QImage::Format_ARGB32);
+	}
+
+	return true;
+}
+
+static inline
+void ALWAYS_INLINE gatherInterior(QRgb c[9], const QRgb * above, const QRgb * row, const QRgb * below, int x)
+{
+	c[0] = above[x-1]; c[3] = above[x]; c[6] = above[x+1];
+	c[1] = row  [x-1]; c[4] = row  [x]; c[7] = row  [x+1];
+	c[2] = below[x-1]; c[5] = below[x]; c[8] = below[x+1];
+}
+
+//neighbors past the edge of the image take the value of the pixel itself
+static
+void gatherEdge(QRgb c[9], const pixel_rows & image, int x, int y)
+{
+	const QRgb center = constLine(image, y)[x];
+
+	for(int _x = -1, i = 0; _x < 2; ++_x)
+	{
+		for(int _y = -1; _y < 2; ++_y, ++i)
+		{
+			if(0 <= x + _x && x + _x < image.width()
+			&& 0 <= y + _y && y + _y < image.height())
+			{
+				c[i] = constLine(image, y + _y)[x + _x];
+			}
+			else
+			{
+				c[i] = center;
+			}
+		}
+	}
+}
+
+static const linear_tables & LINEAR = linearTables();
+
+//the root mean square of the neighbors' colors, summed in linear light
+static inline
+QRgb ALWAYS_INLINE blurTransparentPixel(const QRgb c[9], bool force)
+{
+	int red=0, green=0, blue=0, alpha=0;
+	int a[9];
+	int j = 0;
+
+	for(int i = 0; i < 9; ++i)
+	{
+		red   += LINEAR.linear[qRed(c[i])];
+		green += LINEAR.linear[qGreen(c[i])];
+		blue  += LINEAR.linear[qBlue(c[i])];
+		a[i]   = qAlpha(c[i]);
+		alpha += a[i];
+		j     += a[i] != 0;
+	}
+
+	if((force && j)
+	|| (a[1] && a[7]) || (a[3] && a[5])
+	||(((0 < a[1] && a[1] < 255)
+	||  (0 < a[7] && a[7] < 255))
+	&& ((0 < a[3] && a[3] < 255)
+	||  (0 < a[5] && a[5] < 255))))
+	{
+		return qRgba(
+			LINEAR.encode(red/j),
+			LINEAR.encode(green/j),
+			LINEAR.encode(blue/j),
+			alpha/9);
+	}
+
+	return c[4];
+}
+
+//new alpha of a solid pixel, isolated is set when none of its neighbors are visible
+static inline
+int ALWAYS_INLINE blurSolidPixel(const QRgb c[9], bool & isolated)
+{
+	uint32_t a[9];
+	uint32_t j = 0;
+
+	for(int i = 0; i < 9; ++i)
+	{
+		a[i] = qAlpha(c[i]);
+		j   += a[i];
+	}
+
+	isolated = false;
+
+	if((!a[1] && !a[7]) || (!a[3] && !a[5]))
+	{
+//surrounded by transparency, must be in very loose dither...
+		isolated = j == a[4];
+		return j / 16;
+	}
+
+	return a[4];
+}
+
+//the rows of the result one band may write
+struct output_band
+{
+	output_band(uchar * bits, int bytes_per_line, int begin, int end, int mask = -1) :
+		bits(bits),
+		bytes_per_line(bytes_per_line),
+		mask(mask),
+		begin(begin),
+		end(end)
+	{
+	}
+
+	QRgb * line(int y) const { return reinterpret_cast<QRgb*>(bits + (y & mask) * bytes_per_line); }
+	bool contains(int y) const { return begin <= y && y < end; }
+
+	uchar * bits;
+	int bytes_per_line;
+	int mask;
+	int begin, end;
+};
+
+//an isolated pixel smears its color over the transparent pixels around it, these writes aren't counted as changes.
+//the blurred value is the same one the neighbor gets on its own whenever it changes at all, so the order
+//the pixels are visited in doesn't matter.
+static
+void forceBlurNeighbors(const pixel_rows & original, const output_band & out, int x, int y)
+{
+	QRgb c[9];
+
+	for(int _y = -1; _y < 2; ++_y)
+	{
+		for(int _x = -1; _x < 2; ++_x)
+		{
+			if(!(_x || _y)
+			|| x + _x < 1 || x + _x >= original.width()
+			|| y + _y < 1 || !out.contains(y + _y))
+			{
+				continue;
+			}
+
+			gatherEdge(c, original, x + _x, y + _y);
+			out.line(y + _y)[x + _x] = blurTransparentPixel(c, true);
+		}
+	}
+}
+
+//only fully transparent and fully solid pixels are touched
+static inline
+bool ALWAYS_INLINE isDithered(QRgb c)
+{
+	return qAlpha(c) == 0 || qAlpha(c) == 0xFF;
+}
+
+static inline
+int ALWAYS_INLINE blurColorPixel(const QRgb c[9], const pixel_rows & original, const output_band & out, int x, int y)
+{
+	if(qAlpha(c[4]) == 0)
+	{
+		QRgb t = blurTransparentPixel(c, false);
+
+		if(t != c[4])
+		{
+			out.line(y)[x] = t;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	bool isolated;
+	int t = blurSolidPixel(c, isolated);
+
+	if(isolated)
+	{
+		forceBlurNeighbors(original, out, x, y);
+	}
+
+	if(t != 0xFF)
+	{
+		out.line(y)[x] = (t << 24) | (c[4] & 0x00FFFFFF);
+		return 1;
+	}
+
+	return 0;
+}
+
+//isolated pixels in the row just outside a band still smear into it
+static
+void blurColorHalo(const pixel_rows & original, const output_band & out, int y)
+{
+	const QRgb * row = constLine(original, y);
+	QRgb c[9];
+
+	for(int x = 0; x < original.width(); ++x)
+	{
+		bool isolated;
+
+		if(qAlpha(row[x]) == 0xFF)
+		{
+			gatherEdge(c, original, x, y);
+			blurSolidPixel(c, isolated);
+
+			if(isolated)
+			{
+				forceBlurNeighbors(original, out, x, y);
+			}
+		}
+	}
+}
+
+//a pixel can only change next to one that isn't as transparent or as solid as itself, so the tiles that are
+//all transparent or all opaque along with their neighbors are passed over when there's a tile map.
+static const uint8_t QUIET_TILE = TILE_TRANSPARENT | TILE_OPAQUE;
+
+static
+int blurColorRow(const pixel_rows & original, const output_band & out, int y, const uint8_t * quiet = 0L)
+{
+	const int width  = original.width();
+	const int height = original.height();
+	const QRgb * row = constLine(original, y);
+
+//the first and last rows and columns look up their neighbors one at a time, everything else reads the three lines directly
+	const bool edge = y == 0 || y + 1 == height;
+	const QRgb * above = edge? 0L : constLine(original, y - 1);
+	const QRgb * below = edge? 0L : constLine(original, y + 1);
+
+	QRgb c[9];
+	int no_changed = 0;
+
+	for(int x0 = 0; x0 < width; x0 += TILE_SIZE)
+	{
+		if(quiet && (quiet[x0 >> TILE_SHIFT] & QUIET_TILE))
+		{
+			continue;
+		}
+
+		const int x1 = std::min(x0 + TILE_SIZE, width);
+
+		if(edge)
+		{
+			for(int x = x0; x < x1; ++x)
+			{
+				if(isDithered(row[x]))
+				{
+					gatherEdge(c, original, x, y);
+					no_changed += blurColorPixel(c, original, out, x, y);
+				}
+			}
+
+			continue;
+		}
+
+		if(x0 == 0 && isDithered(row[0]))
+		{
+			gatherEdge(c, original, 0, y);
+			no_changed += blurColorPixel(c, original, out, 0, y);
+		}
+
+		for(int x = std::max(x0, 1); x < std::min(x1, width - 1); ++x)
+		{
+			if(isDithered(row[x]))
+			{
+				gatherInterior(c, above, row, below, x);
+				no_changed += blurColorPixel(c, original, out, x, y);
+			}
+		}
+
+		if(x1 == width && width > 1 && isDithered(row[width-1]))
+		{
+			gatherEdge(c, original, width - 1, y);
+			no_changed += blurColorPixel(c, original, out, width - 1, y);
+		}
+	}
+
+	return no_changed;
+}
+
+static
+int blurColorRows(const pixel_rows & original, const output_band & out, const tile_map & tiles)
+{
+	int no_changed = 0;
+
+	for(int y = out.begin; y < out.end; ++y)
+	{
+		no_changed += blurColorRow(original, out, y, tiles.quietRow(y));
+	}
+
+	if(out.begin > 0)
+	{
+		blurColorHalo(original, out, out.begin - 1);
+	}
+
+	if(out.end < original.height())
+	{
+		blurColorHalo(original, out, out.end);
+	}
+
+	return no_changed;
+}
+
+int blur_colors(QImage & original)
+{
+	if(!prepareImage(original))
+	{
+		return 0;
+	}
+
+//the pass reads a scratch copy and writes the image in place, which is only reallocated if it's shared
+	const size_t size = (size_t) original.bytesPerLine() * original.height();
+	uchar * copy = borrowScratch<uchar>(ARENA_PING, size);
+	memcpy(copy, original.constBits(), size);
+
+	const pixel_rows source(copy, original);
+	const tile_map tiles = buildTileMap(copy, original.bytesPerLine(), original.width(), original.height());
+	uchar * bits = original.bits();
+	const int bytes_per_line = original.bytesPerLine();
+
+	return forEachBand(original.height(), [&source, &tiles, bits, bytes_per_line](int begin, int end)
+	{
+		return blurColorRows(source, output_band(bits, bytes_per_line, begin, end), tiles);
+	});
+}
+
+typedef void (*alpha_row_fn)(const uint8_t * above, const uint8_t * row, const uint8_t * below, int width, uint8_t * out);
+
+//average of the visible alphas around each pixel, o itself is one of them. transparent pixels come out as 0.
+//the rows are padded, [-1] and [width] are readable.
+static
+void averageAlphaScalar(const uint8_t * above, const uint8_t * row, const uint8_t * below, int width, uint8_t * out)
+{
+	for(int x = 0; x < width; ++x)
+	{
+		if(row[x] == 0)
+		{
+			out[x] = 0;
+			continue;
+		}
+
+		int p = 0;
+		int j = 0;
+
+		for(int _x = x-1; _x <= x+1; ++_x)
+		{
+			p += above[_x] + row[_x] + below[_x];
+			j += (above[_x] != 0) + (row[_x] != 0) + (below[_x] != 0);
+		}
+
+		out[x] = p / j;
+	}
+}
+
+#if HAVE_X86_SIMD
+
+//16 pixels at a time: the sums and counts of the nine neighbors in 16 bit lanes, then p/j as a multiply by
+//ceil(65536/j) looked up with a shuffle. for p <= 9*255 the rounding error stays under 1/j, so it's exact.
+static
+void TARGET("avx2") averageAlphaAvx2(const uint8_t * above, const uint8_t * row, const uint8_t * below, int width, uint8_t * out)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one  = _mm256_set1_epi16(1);
+	const __m256i nine = _mm256_set1_epi16(9);
+//reciprocals by count, 0 and 1 aren't used
+	const __m256i recip_lo = _mm256_setr_epi8(
+		0x00, 0x00, 0x00, 0x56, 0x00, 0x34, 0xAB, 0x93, 0x00, 0x72, 0, 0, 0, 0, 0, 0,
+		0x00, 0x00, 0x00, 0x56, 0x00, 0x34, 0xAB, 0x93, 0x00, 0x72, 0, 0, 0, 0, 0, 0);
+	const __m256i recip_hi = _mm256_setr_epi8(
+		0x00, 0x00, 0x80, 0x55, 0x40, 0x33, 0x2A, 0x24, 0x20, 0x1C, 0, 0, 0, 0, 0, 0,
+		0x00, 0x00, 0x80, 0x55, 0x40, 0x33, 0x2A, 0x24, 0x20, 0x1C, 0, 0, 0, 0, 0, 0);
+
+	const uint8_t * lines[3] = { above, row, below };
+
+	int x = 0;
+	for(; x + 16 <= width; x += 16)
+	{
+		__m256i p = zero;
+		__m256i zeros = zero;
+
+		for(int i = 0; i < 3; ++i)
+		{
+			for(int _x = -1; _x < 2; ++_x)
+			{
+				__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (lines[i] + x + _x)));
+				p = _mm256_add_epi16(p, a);
+				zeros = _mm256_sub_epi16(zeros, _mm256_cmpeq_epi16(a, zero));
+			}
+		}
+
+		__m256i j = _mm256_sub_epi16(nine, zeros);
+		__m256i m = _mm256_or_si256(
+			_mm256_and_si256(_mm256_shuffle_epi8(recip_lo, j), _mm256_set1_epi16(0x00FF)),
+			_mm256_slli_epi16(_mm256_shuffle_epi8(recip_hi, j), 8));
+
+		__m256i q = _mm256_mulhi_epu16(p, m);
+		q = _mm256_blendv_epi8(q, p, _mm256_cmpeq_epi16(j, one));
+
+		__m256i o = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (row + x)));
+		q = _mm256_andnot_si256(_mm256_cmpeq_epi16(o, zero), q);
+
+		q = _mm256_permute4x64_epi64(_mm256_packus_epi16(q, zero), 0x08);
+		_mm_storeu_si128((__m128i *) (out + x), _mm256_castsi256_si128(q));
+	}
+
+	averageAlphaScalar(above + x, row + x, below + x, width - x, out + x);
+}
+
+#endif
+
+static
+alpha_row_fn getAlphaKernel()
+{
+#if HAVE_X86_SIMD
+	if(simdLevel() == SIMD_AVX2)
+	{
+		return &averageAlphaAvx2;
+	}
+#endif
+
+	return &averageAlphaScalar;
+}
+
+int blur_alpha(QImage & image)
+{
+	static const alpha_row_fn averageAlpha = getAlphaKernel();
+
+	if(!prepareImage(image))
+	{
+		return 0;
+	}
+
+	const int width  = image.width();
+	const int height = image.height();
+	const int stride = width + 2;
+
+//the transparent pixels keep their 0 and the opaque ones surrounded by opaque ones their 255
+	const tile_map tiles = buildTileMap(image, true);
+
+//alpha with a one pixel border: the leading edges repeat the first row and column,
+//the trailing edges wrap around to them, which is how the neighbors have always been clamped.
+	uint8_t * alpha = borrowScratch<uint8_t>(ARENA_ALPHA, stride * (height + 2));
+
+	forEachBand(height, [&image, alpha, width, height, stride](int begin, int end)
+	{
+		for(int y = (begin == 0? -1 : begin); y < end + (end == height); ++y)
+		{
+			const QRgb * src = constLine(image, (y < 0 || y == height)? 0 : y);
+			uint8_t * dst = &alpha[(y + 1) * stride];
+
+			dst[0] = qAlpha(src[0]);
+
+			for(int x = 0; x < width; ++x)
+			{
+				dst[x+1] = qAlpha(src[x]);
+			}
+
+			dst[width+1] = qAlpha(src[0]);
+		}
+
+		return 0;
+	});
+
+//neighbors are read from the plane, so the image can be written in place.
+//the whole plane is filled in before any band reads its halo rows from it
+	uchar * bits = image.bits();
+	const int bytes_per_line = image.bytesPerLine();
+
+	return forEachBand(height, [bits, bytes_per_line, alpha, width, stride, &tiles](int begin, int end)
+	{
+		const output_band out(bits, bytes_per_line, begin, end);
+		uint8_t * average = borrowScratch<uint8_t>(ARENA_ROW, width);
+		int no_changed = 0;
+
+		for(int y = begin; y < end; ++y)
+		{
+			const uint8_t * row = &alpha[(y + 1) * stride + 1];
+			const uint8_t * quiet = tiles.quietRow(y);
+			QRgb * line = out.line(y);
+
+//the kernel runs over each stretch of tiles that aren't quiet
+			for(int x0 = 0; x0 < width; )
+			{
+				if(quiet[x0 >> TILE_SHIFT] & QUIET_TILE)
+				{
+					x0 += TILE_SIZE;
+					continue;
+				}
+
+				int x1 = x0 + TILE_SIZE;
+				while(x1 < width && !(quiet[x1 >> TILE_SHIFT] & QUIET_TILE))
+				{
+					x1 += TILE_SIZE;
+				}
+
+				x1 = std::min(x1, width);
+				averageAlpha(row - stride + x0, row + x0, row + stride + x0, x1 - x0, average + x0);
+
+				for(int x = x0; x < x1; ++x)
+				{
+					if(average[x] != row[x])
+					{
+						line[x] = (average[x] << 24) | (line[x] & 0x00FFFFFF);
+						++no_changed;
+					}
+				}
+
+				x0 = x1;
+			}
+		}
+
+		return no_changed;
+	});
+}
+
+//what one pass of blur_colors makes of a single pixel, worked out from its surroundings alone.
+//counted is set if the pass would count it as a change.
+static
+QRgb blurColorValue(const pixel_rows & image, int x, int y, bool & counted)
+{
+	QRgb c[9];
+	counted = false;
+
+	if(!isDithered(constLine(image, y)[x]))
+	{
+		return constLine(image, y)[x];
+	}
+
+	gatherEdge(c, image, x, y);
+
+	if(qAlpha(c[4]) == 0)
+	{
+		QRgb t = blurTransparentPixel(c, false);
+
+		if(t != c[4])
+		{
+			counted = true;
+			return t;
+		}
+
+//an isolated solid neighbor smears onto it anyway
+		for(int _y = -1; x > 0 && y > 0 && _y < 2; ++_y)
+		{
+			for(int _x = -1; _x < 2; ++_x)
+			{
+				if(x + _x >= image.width() || y + _y >= image.height()
+				|| qAlpha(constLine(image, y + _y)[x + _x]) != 0xFF)
+				{
+					continue;
+				}
+
+				QRgb n[9];
+				bool isolated;
+				gatherEdge(n, image, x + _x, y + _y);
+				blurSolidPixel(n, isolated);
+
+				if(isolated)
+				{
+					return blurTransparentPixel(c, true);
+				}
+			}
+		}
+
+		return c[4];
+	}
+
+	bool isolated;
+	int t = blurSolidPixel(c, isolated);
+
+	if(t != 0xFF)
+	{
+		counted = true;
+		return (t << 24) | (c[4] & 0x00FFFFFF);
+	}
+
+	return c[4];
+}
+
+static
+QRgb blurAlphaValue(const pixel_rows & image, int x, int y, bool & counted)
+{
+	const QRgb c = constLine(image, y)[x];
+	const int o = qAlpha(c);
+	counted = false;
+
+	if(o == 0)
+	{
+		return c;
+	}
+
+	const int xs[3] = { x == 0? 0 : x-1, x, x + 1 == image.width() ? 0 : x+1 };
+	const int ys[3] = { y == 0? 0 : y-1, y, y + 1 == image.height()? 0 : y+1 };
+
+	int p = 0;
+	int j = 0;
+
+	for(int _y = 0; _y < 3; ++_y)
+	{
+		const QRgb * line = constLine(image, ys[_y]);
+
+		for(int _x = 0; _x < 3; ++_x)
+		{
+			int a = qAlpha(line[xs[_x]]);
+			p += a;
+			j += a != 0;
+		}
+	}
+
+	p = p / j;
+	if(p != o)
+	{
+		counted = true;
+		return (p << 24) | (c & 0x00FFFFFF);
+	}
+
+	return c;
+}
+
+//rows (or columns) within radius of v whose pixels can see v, with wrap the last one also sees the first
+static inline
+int ALWAYS_INLINE dependents(int v, int n, int radius, bool wrap, int out[6])
+{
+	int k = 0;
+
+	for(int i = std::max(0, v - radius); i <= std::min(n - 1, v + radius); ++i)
+	{
+		out[k++] = i;
+	}
+
+	if(wrap && v == 0 && n - 1 > radius)
+	{
+		out[k++] = n - 1;
+	}
+
+	return k;
+}
+
+//runs up to N passes, the first one over the whole image and the rest only over the pixels near
+//something the previous pass changed, as nothing else can come out any different.
+//stops at the same pass and with the same result as repeating the full pass would, or once a pass
+//counts fewer changes than convergence of the frame's pixels. returns the number of passes it ran.
+template<int (*Pass)(QImage &), QRgb (*Value)(const pixel_rows &, int, int, bool &)>
+static
+int incrementalPasses(QImage & image, int passes, int radius, bool wrap, double convergence)
+{
+	if(passes <= 0 || !prepareImage(image))
+	{
+		return 0;
+	}
+
+	const int width  = image.width();
+	const int height = image.height();
+	const size_t size = (size_t) image.bytesPerLine() * height;
+	const int enough = std::max(1, (int) ceil(convergence * width * height));
+
+	uchar * first = borrowScratch<uchar>(ARENA_PONG, size);
+	memcpy(first, image.constBits(), size);
+
+	int counted = Pass(image);
+
+	const pixel_rows before(first, image);
+	const pixel_rows rows(image);
+
+//a pixel is only ever in the lists once per pass
+	int * changed = borrowScratch<int>(ARENA_CHANGED, width * height);
+	int no_changed = 0;
+
+	for(int y = 0; y < height; ++y)
+	{
+		const QRgb * a = before.line(y);
+		const QRgb * b = rows.line(y);
+
+		for(int x = 0; x < width; ++x)
+		{
+			if(a[x] != b[x])
+			{
+				changed[no_changed++] = y * width + x;
+			}
+		}
+	}
+
+	int * stamp = borrowScratch<int>(ARENA_STAMP, width * height);
+	std::pair<int, QRgb> * writes = borrowScratch<std::pair<int, QRgb> >(ARENA_WRITES, width * height);
+	memset(stamp, 0, width * height * sizeof(int));
+
+	int pass = 1;
+
+	for(; pass < passes && counted >= enough && no_changed; ++pass)
+	{
+		int no_writes = 0;
+		counted = 0;
+
+		for(int i = 0; i < no_changed; ++i)
+		{
+			int xs[6], ys[6];
+			int nx = dependents(changed[i] % width, width,  radius, wrap, xs);
+			int ny = dependents(changed[i] / width, height, radius, wrap, ys);
+
+			for(int _y = 0; _y < ny; ++_y)
+			{
+				for(int _x = 0; _x < nx; ++_x)
+				{
+					int j = ys[_y] * width + xs[_x];
+
+					if(stamp[j] == pass)
+					{
+						continue;
+					}
+
+					stamp[j] = pass;
+
+					bool count;
+					QRgb t = Value(rows, xs[_x], ys[_y], count);
+					counted += count;
+
+					if(t != rows.line(ys[_y])[xs[_x]])
+					{
+						writes[no_writes++] = std::make_pair(j, t);
+					}
+				}
+			}
+		}
+
+//the pass already wrote the image, so it isn't shared any more and rows still points at it
+		QRgb * bits = reinterpret_cast<QRgb*>(image.bits());
+		const int stride = image.bytesPerLine() / sizeof(QRgb);
+
+		for(int i = 0; i < no_writes; ++i)
+		{
+			bits[(writes[i].first / width) * stride + writes[i].first % width] = writes[i].second;
+			changed[i] = writes[i].first;
+		}
+
+		no_changed = no_writes;
+	}
+
+	return pass;
+}
+
+dither_passes reverseDither(QImage & image, int blur_iterations, int alpha_iterations, double convergence)
+{
+	dither_passes used;
+//a pixel's value also depends on whether a neighbor of it is isolated, which looks one pixel further
+	used.colors = incrementalPasses<blur_colors, blurColorValue>(image, blur_iterations, 2, false, convergence);
+	used.alphas = incrementalPasses<blur_alpha, blurAlphaValue>(image, alpha_iterations, 1, true, convergence);
+	return used;
+}
+
+enum
+{
+	FUSED_RING = 8,
+	FUSED_MAX_PASSES = 16,
+};
+
+//where one pass of the fused pipeline is: next is the row of its input it does next,
+//done is how many rows of its output are final and can be read by the pass after it
+struct fused_pass
+{
+	int next;
+	int done;
+	int changed;
+};
+
+//how many passes the sequential version would have run, it stops after the first that changes nothing
+static
+int passesUsed(const fused_pass * passes, int n)
+{
+	for(int i = 0; i < n; ++i)
+	{
+		if(!passes[i].changed)
+		{
+			return i + 1;
+		}
+	}
+
+	return n;
+}
+
+//every pass streams over the rows together, each a few rows behind the one before it and reading that one's
+//output from a ring of FUSED_RING lines, so a row goes through all the passes while it's still in cache.
+//
+//a color pass finishes output row y-1 once it has done input row y: an isolated pixel in row y smears into it,
+//and whether it's isolated looks at input row y+1, whose forced neighbors look at y+2.
+//alpha passes only carry the alpha plane from one to the next, the last one's row 0 is kept aside for the wrap.
+//
+//this runs every pass instead of stopping early, which comes out the same: a color pass that counts nothing
+//had no isolated pixels either, so like an alpha pass that counts nothing it changed nothing at all.
+dither_passes reverseDitherFused(QImage & image, int blur_iterations, int alpha_iterations)
+{
+	static const alpha_row_fn averageAlpha = getAlphaKernel();
+
+	if(blur_iterations > FUSED_MAX_PASSES || alpha_iterations > FUSED_MAX_PASSES)
+	{
+		return reverseDither(image, blur_iterations, alpha_iterations);
+	}
+
+	const int colors = std::max(0, blur_iterations);
+	const int alphas = std::max(0, alpha_iterations);
+
+	if(colors + alphas == 0 || !prepareImage(image))
+	{
+		return dither_passes{ 0, 0 };
+	}
+
+	const int width  = image.width();
+	const int height = image.height();
+	const int line_bytes = width * sizeof(QRgb);
+	const int stride = width + 2;
+	const int mask = FUSED_RING - 1;
+
+	uchar * bits = image.bits();
+	const int bytes_per_line = image.bytesPerLine();
+
+//ring 0 has the input, ring s the output of color pass s; the last color pass writes the image itself.
+//plane 0 is the colored image's alpha with a one pixel border like blur_alpha's, plane a the output of alpha pass a.
+//each plane has one more line after its ring for row 0.
+	uchar * rings = borrowScratch<uchar>(ARENA_PING, (size_t) colors * FUSED_RING * line_bytes);
+	uint8_t * planes = borrowScratch<uint8_t>(ARENA_ALPHA, (size_t) (alphas + 1) * (FUSED_RING + 1) * stride);
+
+	auto ring  = [=](int s) { return rings + (size_t) s * FUSED_RING * line_bytes; };
+	auto plane = [=](int a, int y) { return planes + ((size_t) a * (FUSED_RING + 1) + (y & mask)) * stride; };
+	auto first = [=](int a) { return planes + ((size_t) a * (FUSED_RING + 1) + FUSED_RING) * stride; };
+
+	fused_pass color[FUSED_MAX_PASSES] = {};
+	fused_pass alpha[FUSED_MAX_PASSES] = {};
+	int loaded = colors? 0 : height;
+	int planed = 0;
+
+	for(bool progress = true; progress; )
+	{
+		progress = false;
+
+		if(loaded < height)
+		{
+			memcpy(ring(0) + (loaded & mask) * line_bytes, image.constScanLine(loaded), line_bytes);
+			++loaded;
+			progress = true;
+		}
+
+		for(int s = 0; s < colors; ++s)
+		{
+			const int y = color[s].next;
+			const int available = s? color[s-1].done : loaded;
+
+			if(y == height || available < std::min(height, y + 3))
+			{
+				continue;
+			}
+
+			const pixel_rows source(ring(s), line_bytes, width, height, mask);
+			const output_band out = s + 1 < colors
+				? output_band(ring(s + 1), line_bytes, 0, height, mask)
+				: output_band(bits, bytes_per_line, 0, height);
+
+//a row starts out as it was and is written by the input rows on either side of it, as well as its own
+			if(y == 0)
+			{
+				memcpy(out.line(0), source.line(0), line_bytes);
+			}
+
+			if(y + 1 < height)
+			{
+				memcpy(out.line(y + 1), source.line(y + 1), line_bytes);
+			}
+
+			color[s].changed += blurColorRow(source, out, y);
+			color[s].next = y + 1;
+			color[s].done = y + 1 == height? height : y;
+			progress = true;
+		}
+
+		if(alphas && planed < (colors? color[colors-1].done : height))
+		{
+			const QRgb * src = constLine(image, planed);
+			uint8_t * dst = plane(0, planed);
+
+			for(int x = 0; x < width; ++x)
+			{
+				dst[x+1] = qAlpha(src[x]);
+			}
+
+			dst[0] = dst[width+1] = dst[1];
+
+			if(planed == 0)
+			{
+				memcpy(first(0), dst, stride);
+			}
+
+			++planed;
+			progress = true;
+		}
+
+		for(int a = 0; a < alphas; ++a)
+		{
+			const int y = alpha[a].next;
+			const int available = a? alpha[a-1].done : planed;
+
+			if(y == height || available < std::min(height, y + 2))
+			{
+				continue;
+			}
+
+			const uint8_t * row   = plane(a, y) + 1;
+			const uint8_t * above = y == 0? row : plane(a, y - 1) + 1;
+			const uint8_t * below = y + 1 == height? first(a) + 1 : plane(a, y + 1) + 1;
+			uint8_t * dst = plane(a + 1, y);
+
+			averageAlpha(above, row, below, width, dst + 1);
+			dst[0] = dst[width+1] = dst[1];
+
+			for(int x = 0; x < width; ++x)
+			{
+				alpha[a].changed += dst[x+1] != row[x];
+			}
+
+			if(y == 0)
+			{
+				memcpy(first(a + 1), dst, stride);
+			}
+
+			if(a + 1 == alphas)
+			{
+				QRgb * line = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+
+				for(int x = 0; x < width; ++x)
+				{
+					line[x] = (dst[x+1] << 24) | (line[x] & 0x00FFFFFF);
+				}
+			}
+
+			alpha[a].next = y + 1;
+			alpha[a].done = y + 1;
+			progress = true;
+		}
+	}
+
+	return dither_passes{ passesUsed(color, colors), passesUsed(alpha, alphas) };
+}
+
+QImage blur_colors(const QImage & original, int blur_iterations)
+{
+	QImage retn(original);
+	incrementalPasses<blur_colors, blurColorValue>(retn, blur_iterations, 2, false, 0);
+	return retn;
+}
+
+QImage blur_alpha(const QImage & original, int blur_iterations)
+{
+	QImage retn(original);
+	incrementalPasses<blur_alpha, blurAlphaValue>(retn, blur_iterations, 1, true, 0);
+	return retn;
+}
@@ -0,0 +1,30 @@
+#ifndef REVERSEDITHER_H
+#define REVERSEDITHER_H
+#include <QImage>
+
+//one pass of reverse dithering, both return the number of pixels they changed.
+//blur_colors fills transparent holes in a dither with their neighbors and fades isolated solid pixels,
+//blur_alpha averages each visible pixel's alpha with its visible neighbors.
+int blur_colors(QImage & original);
+int blur_alpha(QImage & image);
+
+//up to N passes, stopping early once a pass changes nothing. only the first pass looks at the whole image,
+//the rest revisit what is next to the previous pass's changes and give the same result as full passes.
+QImage blur_colors(const QImage & original, int blur_iterations);
+QImage blur_alpha(const QImage & original, int blur_iterations);
+
+//how many passes of each filter a frame took
+struct dither_passes
+{
+	int colors;
+	int alphas;
+};
+
+//both filters on the image itself, as the import does them. the buffers come from the thread's frame arena.
+//a filter also stops after a pass that changes fewer than convergence of the frame's pixels, 0 waits for none.
+dither_passes reverseDither(QImage & image, int blur_iterations, int alpha_iterations, double convergence = 0);
+//the same result from one sweep down the image, with all the passes a few rows apart. it can't stop
+//any earlier than the passes that change nothing.
+dither_passes reverseDitherFused(QImage & image, int blur_iterations, int alpha_iterations);
+
+#endif // REVERSEDITHER_H
@@ -1,53 +1,103 @@
 #include <QImage>
+#include <cstring>
+#include "tilemap.h"
+#include "framearena.h"
 
 
-void scaleSuperXbr(uint32_t * data, uint32_t * out, int w, int h);
+void scaleSuperXbr(const uint32_t * data, uint32_t * const out[], int steps, int w, int h, const tile_map & tiles, bool fixed);
 
 
+//the scaler wants packed rows. images qt allocates never pad 32 bit rows, so this is only needed
+//for one wrapped around someone else's memory.
 static
-void xBrLoop(std::vector<uint32_t> & pixel_data, int & width, int & height)
+const uint32_t * packedRows(const QImage & image)
 {
-	std::vector<uint32_t> output;
-	output.resize((width*2)*(height*2));
+	const size_t row = image.width() * sizeof(uint32_t);
 
-	scaleSuperXbr(pixel_data.data(), output.data(), width, height);
+	if(image.bytesPerLine() == (int) row)
+	{
+		return reinterpret_cast<const uint32_t*>(image.constBits());
+	}
 
-	width *= 2;
-	height *= 2;
-	pixel_data = output;
-}
+	uint32_t * packed = borrowScratch<uint32_t>(ARENA_PACKED, (size_t) image.width() * image.height());
+
+	for(int y = 0; y < image.height(); ++y)
+	{
+		memcpy(packed + y * image.width(), image.constScanLine(y), row);
+	}
 
+	return packed;
+}
 
-QImage double_image(QImage image)
+//scales src into dst by factor, rounded down to a power of two, as that many doublings in a row.
+//fixed uses the integer scaler, whose output is the same on every machine.
+//dst keeps src's premultiplication. it is only reallocated if it isn't already the right size in the
+//same format with packed rows, and shouldn't be shared or bits() will copy it.
+void scale_image(QImage src, QImage & dst, int factor, bool fixed)
 {
-	int width = image.width();
-	int height = image.height();
+	if(src.format() != QImage::Format_ARGB32
+	&& src.format() != QImage::Format_ARGB32_Premultiplied)
+	{
+		src = src.convertToFormat(QImage::Format_ARGB32);
+	}
+
+	int steps = 0;
+	while(steps < 15 && (2 << steps) <= factor)
+	{
+		++steps;
+	}
+
+	if(steps == 0)
+	{
+		dst = src;
+		return;
+	}
 
-	std::vector<uint32_t> pixel_data;
-	pixel_data.resize(width*height);
+	const QSize size(src.width() << steps, src.height() << steps);
 
-	int i = 0;
-	for(int y = 0; y < height; ++y)
+	if(dst.size() != size
+	|| dst.format() != src.format()
+	|| dst.bytesPerLine() != size.width() * (int) sizeof(uint32_t))
 	{
-		for(int x = 0; x < width; ++x, ++i)
-		{
-			pixel_data[i] = image.pixel(x, y);
-		}
+		dst = QImage(size, src.format());
 	}
 
-	xBrLoop(pixel_data, width, height);
+//the steps before the last go in the arena, one after another
+	const size_t pixels = (size_t) src.width() * src.height();
+	size_t stage_pixels = 0;
+
+	for(int i = 1; i < steps; ++i)
+	{
+		stage_pixels += pixels << (2*i);
+	}
 
-	QImage retn(width, height, QImage::Format_ARGB32_Premultiplied);
-	retn.fill(0);
+	uint32_t * stages = borrowScratch<uint32_t>(ARENA_STAGES, stage_pixels);
+	uint32_t * out[15];
 
-	i = 0;
-	for(int y = 0; y < height; ++y)
+	for(int i = 1; i < steps; ++i)
 	{
-		for(int x = 0; x < width; ++x, ++i)
-		{
-			retn.setPixel(x, y, pixel_data[i]);
-		}
+		out[i-1] = stages;
+		stages  += pixels << (2*i);
 	}
 
+	out[steps-1] = reinterpret_cast<uint32_t*>(dst.bits());
+
+	scaleSuperXbr(packedRows(src), out, steps, src.width(), src.height(), buildTileMap(src), fixed);
+}
+
+QImage scale_image(QImage image, int factor, bool fixed)
+{
+	QImage retn;
+	scale_image(image, retn, factor, fixed);
 	return retn;
 }
+
+void double_image(QImage src, QImage & dst)
+{
+	scale_image(src, dst, 2, false);
+}
+
+QImage double_image(QImage image)
+{
+	return scale_image(image, 2, false);
+}
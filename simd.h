@@ -0,0 +1,103 @@
+#ifndef SIMD_H
+#define SIMD_H
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#define TARGET(x) __attribute((target(x)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define HAVE_X86_SIMD 1
+#define TARGET(x)
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#define HAVE_X86_SIMD 0
+#define TARGET(x)
+#endif
+
+enum SimdLevel
+{
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2
+};
+
+static inline
+SimdLevel detectSimdLevel()
+{
+#if !HAVE_X86_SIMD
+	return SIMD_SCALAR;
+#elif defined(__GNUC__)
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return SIMD_AVX2;
+	}
+
+	return __builtin_cpu_supports("sse2")? SIMD_SSE2 : SIMD_SCALAR;
+#else
+	int info[4];
+	__cpuid(info, 1);
+
+//avx2 also needs the os to save the ymm registers
+	if((info[2] & (1 << 27)) && (_xgetbv(0) & 0x06) == 0x06)
+	{
+		__cpuidex(info, 7, 0);
+		if(info[1] & (1 << 5))
+		{
+			return SIMD_AVX2;
+		}
+	}
+
+	return SIMD_SSE2;
+#endif
+}
+
+//detected once, SPRITEBUILDER_SIMD=scalar|sse2|avx2 can lower it for comparisons
+inline
+SimdLevel simdLevel()
+{
+	static const SimdLevel level = []()
+	{
+		SimdLevel level = detectSimdLevel();
+		const char * env = getenv("SPRITEBUILDER_SIMD");
+
+		if(env)
+		{
+			SimdLevel request = level;
+
+			if(!strcmp(env, "scalar"))    request = SIMD_SCALAR;
+			else if(!strcmp(env, "sse2")) request = SIMD_SSE2;
+			else if(!strcmp(env, "avx2")) request = SIMD_AVX2;
+
+			level = request < level? request : level;
+		}
+
+		return level;
+	}();
+
+	return level;
+}
+
+//index of the lowest set bit, x must not be 0
+static inline
+int countTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return i;
+#else
+	int i = 0;
+	for(; !(x & 1); x >>= 1, ++i) {}
+	return i;
+#endif
+}
+
+#endif // SIMD_H
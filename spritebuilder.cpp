@@ -2,6 +2,8 @@
 #include "ui_spritebuilder.h"
 #include "commandchain.h"
 #include "imageview.h"
+#include "spritefile.h"
+#include "spriteencoder.h"
 #include <QKeyEvent>
 #include <QWheelEvent>
 #include <QFileDialog>
@@ -33,6 +35,7 @@ ui(new Ui::SpriteBuilder)
 	connect(ui->actionImportC1,	SIGNAL(triggered()), this, SLOT(importC1()));
 	connect(ui->actionAbout,	SIGNAL(triggered()), this, SLOT(helpAbout()));
 	connect(ui->actionExportAll,	SIGNAL(triggered()),this, SLOT(documentExportAll()));
+	connect(ui->actionExportC16,	SIGNAL(triggered()),this, SLOT(documentExportC16()));
 
 
 	connect(ui->actionUndo,		SIGNAL(triggered()), this, SLOT(editUndo()));
@@ -107,12 +110,6 @@ void SpriteBuilder::editRedo()
 	updateTitleBar();
 }
 
-struct image_header
-{
-	uint16_t width, height;
-	uint32_t offset[5];
-};
-
 void SpriteBuilder::documentOpen()
 {
 	if(!documentPreClose())
@@ -141,6 +138,7 @@ void SpriteBuilder::documentOpen()
 		return;
 	}
 
+	ui->tableWidget->cancelImport();
 	ui->tableWidget->clearContents();
 	ui->tableWidget->setRowCount(0);
 	autosave_timer.stop();
@@ -156,12 +154,14 @@ void SpriteBuilder::documentOpen()
 	std::vector<image_header> header(byte_swap(size));
 	fread(header.data(), sizeof(image_header), size, file);
 
+	std::vector<sprite_row> rows(header.size());
+
 	for(int i = 0; i < header.size(); ++i)
 	{
 		header[i].width = byte_swap(header[i].width);
 		header[i].height = byte_swap(header[i].height);
 
-		ui->tableWidget->insertRow(i);
+		rows[i].resize(ui->tableWidget->columnCount(), 0L);
 		for(int j = 0; j < ui->tableWidget->columnCount(); ++j)
 		{
 			if(!header[i].offset[j])
@@ -173,14 +173,13 @@ void SpriteBuilder::documentOpen()
 			fseek(file, byte_swap(header[i].offset[j]), SEEK_SET);
 
 			image->readImage(file, header[i].width, header[i].height);
-			ui->tableWidget->setItem(i, j, image);
+			rows[i][j] = image;
 		}
 	}
 
 	fclose(file);
 
-	ui->tableWidget->resizeColumnsToContents();
-	ui->tableWidget->resizeRowsToContents();
+	ui->tableWidget->appendRows(rows);
 
 	autosave_timer.start();
 	updateTitleBar();
@@ -209,48 +208,21 @@ void SpriteBuilder::_documentSave()
 	}
 
 	ui->tableWidget->command_list.onSave();
+	ui->tableWidget->loadAllRows();
 
-	int _one = byte_swap((unsigned int) 1);
-
-	fwrite(&_one, 4, 1, file);
-	short size = byte_swap(ui->tableWidget->rowCount());
-	fwrite(&size, sizeof(size), 1, file);
-
-	fpos_t header_pos;
-	fgetpos(file, &header_pos);
-	std::vector<image_header> header(size);
-	fseek(file, size * sizeof(image_header), SEEK_CUR);
+	std::vector<sprite_row> rows(ui->tableWidget->rowCount());
 
 	for(int k = 0; k < ui->tableWidget->rowCount(); ++k)
 	{
-		int i = ui->tableWidget->visualRow(k);
-
-		bool saved_metadata = false;
+		auto & row = rows[ui->tableWidget->visualRow(k)];
 
 		for(int j = 0; j < 4; ++j)
 		{
-			auto image = dynamic_cast<ImageView*>(ui->tableWidget->item(k, j));
-
-			if(!image || image->image.isNull())
-			{
-				continue;
-			}
-
-			if(!saved_metadata)
-			{
-				saved_metadata      = true;
-				header[i].width     = byte_swap((uint16_t) image->image.width());
-				header[i].height    = byte_swap((uint16_t) image->image.height());
-			}
-
-
-			header[i].offset[j] = byte_swap((uint32_t) ftell(file));
-			image->writeImage(file);
+			row.push_back(dynamic_cast<ImageView*>(ui->tableWidget->item(k, j)));
 		}
 	}
 
-	fsetpos(file, &header_pos);
-	fwrite(header.data(), sizeof(image_header), size, file);
+	writeSpriteFile(file, rows);
 
 	fclose(file);
 	updateTitleBar();
@@ -305,6 +277,7 @@ void SpriteBuilder::documentExportAll()
     while (dialog.exec() == QDialog::Accepted)
 	{
 		QImageWriter writer;
+		ui->tableWidget->loadAllRows();
 
 		for(int i = 0; i < ui->tableWidget->rowCount(); ++i)
 		{
@@ -346,6 +319,57 @@ void SpriteBuilder::documentExportAll()
 	}
 }
 
+void SpriteBuilder::documentExportC16()
+{
+	QStringList filters;
+	filters << tr("Creatures 2 Sprite, 565 (*.c16)")
+			<< tr("Creatures 2 Sprite, 555 (*.c16)")
+			<< tr("Creatures 2 Sprite, uncompressed 565 (*.s16)")
+			<< tr("Creatures 2 Sprite, uncompressed 555 (*.s16)");
+
+	QString filter;
+	QString name = QFileDialog::getSaveFileName(this, tr("Export Creatures Sprite"), QString(), filters.join(";;"), &filter);
+
+	if(name.isEmpty())
+	{
+		return;
+	}
+
+	int format = std::max(0, filters.indexOf(filter));
+
+	ui->tableWidget->loadAllRows();
+
+//frames go in the order the rows are shown, empty rows are written as blank frames
+	std::vector<QImage> frames(ui->tableWidget->rowCount());
+	QSize blank;
+
+	for(int i = 0; i < ui->tableWidget->rowCount(); ++i)
+	{
+		auto image = ui->tableWidget->imageAt(i, BAKED_IMAGE_SLOT);
+
+		if(image && !image->image.isNull())
+		{
+			frames[ui->tableWidget->visualRow(i)] = image->image;
+			blank = blank.isValid()? blank : image->image.size();
+		}
+	}
+
+	for(auto & frame : frames)
+	{
+		if(frame.isNull())
+		{
+			frame = QImage(blank.isValid()? blank : QSize(1, 1), QImage::Format_ARGB32);
+			frame.fill(0);
+		}
+	}
+
+	if(!writeC16File(name, frames, format < 2, !(format & 1)))
+	{
+		QMessageBox mesg;
+		mesg.setText(QObject::tr("Unable to open file '%1' for writing.").arg(name));
+		mesg.exec();
+	}
+}
 
 bool SpriteBuilder::documentPreClose()
 {
@@ -374,6 +398,7 @@ bool SpriteBuilder::documentClose()
 {
 	if(documentPreClose())
 	{
+		ui->tableWidget->cancelImport();
 		ui->tableWidget->clearContents();
 		ui->tableWidget->setRowCount(0);
 		autosave_timer.stop();
@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 #include <QTimer>
+#include <QSharedPointer>
+#include <vector>
 
 #define MARGIN_SIZE 20
 
@@ -10,6 +12,10 @@ namespace Ui {
 class SpriteBuilder;
 }
 
+struct import_job;
+struct import_source;
+struct sprite_format;
+
 class SpriteBuilder : public QMainWindow
 {
 	Q_OBJECT
@@ -38,6 +44,7 @@ public slots:
 	void documentExport();
 	void documentImport();
 	void documentExportAll();
+	void documentExportC16();
 	bool documentClose();
 
 	void toolsPruneC2Sprites();
@@ -51,6 +58,9 @@ public slots:
 
 private:
 	bool documentPreClose();
+	void importSprite(const sprite_format * preferred);
+//the rows are placeholders until the frames are decoded from the source
+	void insertImportedFrames(std::vector<import_job> & jobs, const QSharedPointer<const import_source> & source);
 	Ui::SpriteBuilder *ui;
 };
 
@@ -0,0 +1,327 @@
+#include "spritedecoder.h"
+#include "byteswap.h"
+#include "pixelconvert.h"
+#include "pallet_dta.h"
+#include <algorithm>
+#include <cstring>
+
+template<typename T>
+static inline
+T ALWAYS_INLINE readLE(const uchar * p)
+{
+	T t;
+	memcpy(&t, p, sizeof(T));
+	return byte_swap(t);
+}
+
+C16Decoder::C16Decoder() :
+	data(0L),
+	size(0),
+	_565(false),
+	_c16(false)
+{
+}
+
+C16Decoder::~C16Decoder()
+{
+	close();
+}
+
+C16Decoder::Status C16Decoder::open(const QString & filename)
+{
+	close();
+
+	file.setFileName(filename);
+	if(!file.open(QIODevice::ReadOnly))
+	{
+		return Unreadable;
+	}
+
+	const uchar * map = file.map(0, file.size());
+
+	if(!map)
+	{
+		file.close();
+		return Unreadable;
+	}
+
+	Status status = open(map, file.size());
+
+	if(status != Okay)
+	{
+		file.close();
+	}
+
+	return status;
+}
+
+C16Decoder::Status C16Decoder::open(const uchar * map, size_t length)
+{
+	header.clear();
+	data = 0L;
+	size = 0;
+
+	if(length < 6)
+	{
+		return Corrupt;
+	}
+
+	uint32_t bit_flags = readLE<uint32_t>(map);
+
+	if(bit_flags > 3)
+	{
+		return Corrupt;
+	}
+
+	_565 = bit_flags & 0x01;
+	_c16 = bit_flags & 0x02;
+
+	uint16_t no_images = readLE<uint16_t>(map + 4);
+	header.resize(no_images);
+
+	size_t pos = 6;
+	for(uint16_t i = 0; i < no_images; ++i)
+	{
+		if(pos + 8 > length)
+		{
+			header.clear();
+			return Corrupt;
+		}
+
+		header[i].offset = readLE<uint32_t>(map + pos);
+		header[i].width  = readLE<uint16_t>(map + pos + 4);
+		header[i].height = readLE<uint16_t>(map + pos + 6);
+		header[i].line_offsets = 0L;
+		pos += 8;
+
+		if(_c16 && header[i].height)
+		{
+			header[i].line_offsets = map + pos;
+			pos += (header[i].height - 1) * sizeof(uint32_t);
+		}
+	}
+
+	if(pos > length)
+	{
+		header.clear();
+		return Corrupt;
+	}
+
+	data = map;
+	size = length;
+	return Okay;
+}
+
+void C16Decoder::close()
+{
+	header.clear();
+	data = 0L;
+	size = 0;
+
+	if(file.isOpen())
+	{
+		file.close();
+	}
+}
+
+bool C16Decoder::decodeFrame(int i, QImage & image) const
+{
+	if(i < 0 || i >= frameCount())
+	{
+		return false;
+	}
+
+	const frame_header & frame = header[i];
+
+	if(image.width() < frame.width || image.height() < frame.height)
+	{
+		return false;
+	}
+
+	return _c16? decodeC16(frame, image) : decodeS16(frame, image);
+}
+
+bool C16Decoder::decodeC16(const frame_header & frame, QImage & image) const
+{
+	const uchar * end = data + size;
+
+	for(int y = 0; y < frame.height; ++y)
+	{
+		uint32_t offset = y == 0? frame.offset : readLE<uint32_t>(frame.line_offsets + (y-1)*sizeof(uint32_t));
+
+		if(offset >= size)
+		{
+			return false;
+		}
+
+		const uchar * p = data + offset;
+		QRgb * line = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+		for(int x = 0; x < frame.width; )
+		{
+			if(p + 2 > end)
+			{
+				return false;
+			}
+
+			uint16_t tag = readLE<uint16_t>(p);
+			p += 2;
+
+			bool transparent = !(tag & 0x0001);
+			int run = tag >> 1;
+
+//end of line marker
+			if(run == 0)
+			{
+				break;
+			}
+
+			if(transparent)
+			{
+				x += run;
+				continue;
+			}
+
+			run = std::min(run, frame.width - x);
+
+			if(p + run*2 > end)
+			{
+				return false;
+			}
+
+			convertSpan(p, line + x, run, _565);
+			x += run;
+			p += run*2;
+		}
+	}
+
+	return true;
+}
+
+bool C16Decoder::decodeS16(const frame_header & frame, QImage & image) const
+{
+	if(frame.offset + (size_t) frame.width*frame.height*2 > size)
+	{
+		return false;
+	}
+
+	const uchar * p = data + frame.offset;
+
+	for(int y = 0; y < frame.height; ++y)
+	{
+		convertSpan(p, reinterpret_cast<QRgb*>(image.scanLine(y)), frame.width, _565, true);
+		p += frame.width*2;
+	}
+
+	return true;
+}
+
+SprDecoder::SprDecoder() :
+	data(0L),
+	size(0)
+{
+}
+
+SprDecoder::~SprDecoder()
+{
+	close();
+}
+
+SprDecoder::Status SprDecoder::open(const QString & filename)
+{
+	close();
+
+	file.setFileName(filename);
+	if(!file.open(QIODevice::ReadOnly))
+	{
+		return Unreadable;
+	}
+
+	const uchar * map = file.map(0, file.size());
+
+	if(!map)
+	{
+		file.close();
+		return Unreadable;
+	}
+
+	Status status = open(map, file.size());
+
+	if(status != Okay)
+	{
+		file.close();
+	}
+
+	return status;
+}
+
+SprDecoder::Status SprDecoder::open(const uchar * map, size_t length)
+{
+	header.clear();
+	data = 0L;
+	size = 0;
+
+	if(length < 2)
+	{
+		return Corrupt;
+	}
+
+	uint16_t no_images = readLE<uint16_t>(map);
+
+	if(2 + no_images*8u > length)
+	{
+		return Corrupt;
+	}
+
+	header.resize(no_images);
+
+	for(uint16_t i = 0; i < no_images; ++i)
+	{
+		const uchar * p = map + 2 + i*8;
+
+		header[i].offset = readLE<uint32_t>(p);
+		header[i].width  = readLE<uint16_t>(p + 4);
+		header[i].height = readLE<uint16_t>(p + 6);
+	}
+
+	data = map;
+	size = length;
+	return Okay;
+}
+
+void SprDecoder::close()
+{
+	header.clear();
+	data = 0L;
+	size = 0;
+
+	if(file.isOpen())
+	{
+		file.close();
+	}
+}
+
+bool SprDecoder::decodeFrame(int i, QImage & image) const
+{
+	if(i < 0 || i >= frameCount())
+	{
+		return false;
+	}
+
+	const frame_header & frame = header[i];
+
+	if(image.width() < frame.width || image.height() < frame.height
+	|| frame.offset + (size_t) frame.width*frame.height > size)
+	{
+		return false;
+	}
+
+	const uint8_t * value = data + frame.offset;
+
+	for(int y = 0; y < frame.height; ++y, value += frame.width)
+	{
+		expandIndexed(value, reinterpret_cast<QRgb*>(image.scanLine(y)), frame.width, PALETTE_ARGB);
+	}
+
+	return true;
+}
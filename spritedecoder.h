@@ -0,0 +1,122 @@
+#ifndef SPRITEDECODER_H
+#define SPRITEDECODER_H
+#include <QFile>
+#include <QImage>
+#include <vector>
+
+//what every sprite format provides to the import pipeline, decodeFrame() is const
+//and can be called for any frame in any order from any thread.
+class SpriteDecoder
+{
+public:
+	enum Status
+	{
+		Okay,
+		Unreadable,
+		Corrupt
+	};
+
+	virtual ~SpriteDecoder() {}
+
+	virtual Status open(const QString & filename) = 0;
+//also serves as the probe, only the header is looked at
+	virtual Status open(const uchar * data, size_t size) = 0;
+	virtual void close() = 0;
+
+	virtual bool isOpen() const = 0;
+	virtual size_t fileSize() const = 0;
+
+	virtual int frameCount() const = 0;
+	virtual QSize frameSize(int i) const = 0;
+
+//image must be Format_ARGB32 and at least as large as the frame,
+//only opaque pixels are written.
+	virtual bool decodeFrame(int i, QImage & image) const = 0;
+};
+
+//reads .c16/.s16 files straight out of a read-only mapping of the file.
+class C16Decoder : public SpriteDecoder
+{
+public:
+	struct frame_header
+	{
+		uint32_t offset;
+		uint16_t width, height;
+//c16 only, the remaining height-1 line offsets of the frame
+		const uchar * line_offsets;
+	};
+
+	C16Decoder();
+	~C16Decoder();
+
+	Status open(const QString & filename);
+	Status open(const uchar * data, size_t size);
+	void close();
+
+	bool isOpen()  const { return data != 0L; }
+	bool is565()   const { return _565; }
+	bool isC16()   const { return _c16; }
+	size_t fileSize() const { return size; }
+
+	int frameCount() const { return header.size(); }
+	QSize frameSize(int i) const { return QSize(header[i].width, header[i].height); }
+	const frame_header & frame(int i) const { return header[i]; }
+
+	bool decodeFrame(int i, QImage & image) const;
+
+private:
+	C16Decoder(const C16Decoder &);
+	C16Decoder & operator=(const C16Decoder &);
+
+	bool decodeC16(const frame_header & frame, QImage & image) const;
+	bool decodeS16(const frame_header & frame, QImage & image) const;
+
+	QFile file;
+	const uchar * data;
+	size_t size;
+
+	bool _565;
+	bool _c16;
+
+	std::vector<frame_header> header;
+};
+
+//reads creatures 1 .spr files the same way, pixels are indices into PALETTE_DTA
+//and black palette entries are left transparent.
+class SprDecoder : public SpriteDecoder
+{
+public:
+	struct frame_header
+	{
+		uint32_t offset;
+		uint16_t width, height;
+	};
+
+	SprDecoder();
+	~SprDecoder();
+
+	Status open(const QString & filename);
+	Status open(const uchar * data, size_t size);
+	void close();
+
+	bool isOpen()  const { return data != 0L; }
+	size_t fileSize() const { return size; }
+
+	int frameCount() const { return header.size(); }
+	QSize frameSize(int i) const { return QSize(header[i].width, header[i].height); }
+	const frame_header & frame(int i) const { return header[i]; }
+
+	bool decodeFrame(int i, QImage & image) const;
+
+private:
+	SprDecoder(const SprDecoder &);
+	SprDecoder & operator=(const SprDecoder &);
+
+	QFile file;
+	const uchar * data;
+	size_t size;
+
+	std::vector<frame_header> header;
+};
+
+#endif // SPRITEDECODER_H
@@ -0,0 +1,303 @@
+#include "spriteencoder.h"
+#include "byteswap.h"
+#include "simd.h"
+#include <QtConcurrent>
+#include <QFile>
+#include <algorithm>
+
+typedef void (*mask_fn)(const QRgb * line, int width, uint64_t * mask);
+
+//longest run a tag can hold
+#define MAX_RUN 0x7FFF
+
+static inline
+uint16_t ALWAYS_INLINE toWord(QRgb c, bool _565)
+{
+	if(_565)
+	{
+		return ((qRed(c) >> 3) << 11) | ((qGreen(c) >> 2) << 5) | (qBlue(c) >> 3);
+	}
+
+	return ((qRed(c) >> 3) << 10) | ((qGreen(c) >> 3) << 5) | (qBlue(c) >> 3);
+}
+
+//one bit per pixel, set where the alpha is 128 or more which is just the sign bit of the pixel
+static
+void maskScalar(const QRgb * line, int width, uint64_t * mask)
+{
+	for(int x = 0; x < width; x += 64)
+	{
+		uint64_t word = 0;
+		int n = std::min(64, width - x);
+
+		for(int i = 0; i < n; ++i)
+		{
+			word |= (uint64_t) (line[x+i] >> 31) << i;
+		}
+
+		mask[x >> 6] = word;
+	}
+}
+
+#if HAVE_X86_SIMD
+
+static
+void TARGET("sse2") maskSse2(const QRgb * line, int width, uint64_t * mask)
+{
+	int x = 0;
+	for(; x + 64 <= width; x += 64)
+	{
+		uint64_t word = 0;
+
+		for(int i = 0; i < 64; i += 4)
+		{
+			__m128 v = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (line + x + i)));
+			word |= (uint64_t) _mm_movemask_ps(v) << i;
+		}
+
+		mask[x >> 6] = word;
+	}
+
+	maskScalar(line + x, width - x, mask + (x >> 6));
+}
+
+static
+void TARGET("avx2") maskAvx2(const QRgb * line, int width, uint64_t * mask)
+{
+	int x = 0;
+	for(; x + 64 <= width; x += 64)
+	{
+		uint64_t word = 0;
+
+		for(int i = 0; i < 64; i += 8)
+		{
+			__m256 v = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (line + x + i)));
+			word |= (uint64_t) _mm256_movemask_ps(v) << i;
+		}
+
+		mask[x >> 6] = word;
+	}
+
+	maskScalar(line + x, width - x, mask + (x >> 6));
+}
+
+#endif
+
+static
+mask_fn getMaskKernel()
+{
+#if HAVE_X86_SIMD
+	switch(simdLevel())
+	{
+	case SIMD_AVX2:
+		return &maskAvx2;
+	case SIMD_SSE2:
+		return &maskSse2;
+	default:
+		break;
+	}
+#endif
+
+	return &maskScalar;
+}
+
+//number of pixels from x on that are opaque (or transparent), 64 at a time
+static
+int runLength(const uint64_t * mask, int x, int width, bool opaque)
+{
+	int start = x;
+
+	while(x < width)
+	{
+		uint64_t word = mask[x >> 6] >> (x & 63);
+		uint64_t stop = opaque? ~word : word;
+		int bits = 64 - (x & 63);
+		int n = stop? std::min(countTrailingZeros(stop), bits) : bits;
+
+		x += n;
+
+		if(n < bits)
+		{
+			break;
+		}
+	}
+
+	return std::min(x, width) - start;
+}
+
+static
+void encodeC16(const QImage & image, bool _565, encoded_frame & frame)
+{
+	static const mask_fn buildMask = getMaskKernel();
+
+	std::vector<uint64_t> mask((image.width() + 63) / 64);
+	frame.lines.reserve(image.height());
+
+	for(int y = 0; y < image.height(); ++y)
+	{
+		const QRgb * line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+		buildMask(line, image.width(), mask.data());
+		frame.lines.push_back(frame.data.size());
+
+		for(int x = 0; x < image.width(); )
+		{
+			int run = runLength(mask.data(), x, image.width(), false);
+
+//transparency up to the end of the line is implied
+			if(x + run >= image.width())
+			{
+				break;
+			}
+
+			for(x += run; run > 0; run -= MAX_RUN)
+			{
+				frame.data.push_back(byte_swap((uint16_t) (std::min(run, MAX_RUN) << 1)));
+			}
+
+			run = runLength(mask.data(), x, image.width(), true);
+
+			while(run > 0)
+			{
+				int n = std::min(run, MAX_RUN);
+				frame.data.push_back(byte_swap((uint16_t) ((n << 1) | 0x0001)));
+
+				for(int i = 0; i < n; ++i, ++x)
+				{
+					frame.data.push_back(byte_swap(toWord(line[x], _565)));
+				}
+
+				run -= n;
+			}
+		}
+
+		frame.data.push_back(0);
+	}
+
+//end of image marker
+	frame.data.push_back(0);
+}
+
+static
+void encodeS16(const QImage & image, bool _565, encoded_frame & frame)
+{
+	frame.data.reserve(image.width() * image.height());
+
+	for(int y = 0; y < image.height(); ++y)
+	{
+		const QRgb * line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+		for(int x = 0; x < image.width(); ++x)
+		{
+			uint16_t c = 0;
+
+//0 is transparent in s16, so opaque black is nudged to the darkest blue
+			if(qAlpha(line[x]) >= 128)
+			{
+				c = std::max<uint16_t>(toWord(line[x], _565), 1);
+			}
+
+			frame.data.push_back(byte_swap(c));
+		}
+	}
+}
+
+encoded_frame encodeFrame(const QImage & image, bool c16, bool _565)
+{
+	const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+
+	encoded_frame frame;
+	frame.width  = argb.width();
+	frame.height = argb.height();
+
+	if(c16)
+	{
+		encodeC16(argb, _565, frame);
+	}
+	else
+	{
+		encodeS16(argb, _565, frame);
+	}
+
+	return frame;
+}
+
+template<typename T>
+static inline
+void ALWAYS_INLINE writeLE(std::vector<uchar> & out, size_t pos, T t)
+{
+	t = byte_swap(t);
+	memcpy(out.data() + pos, &t, sizeof(T));
+}
+
+bool writeC16File(const QString & filename, const std::vector<QImage> & frames, bool c16, bool _565)
+{
+	struct encode_job
+	{
+		const QImage * image;
+		encoded_frame frame;
+	};
+
+	std::vector<encode_job> jobs(frames.size());
+
+	for(size_t i = 0; i < frames.size(); ++i)
+	{
+		jobs[i].image = &frames[i];
+	}
+
+	QtConcurrent::blockingMap(jobs, [c16, _565](encode_job & job)
+	{
+		job.frame = encodeFrame(*job.image, c16, _565);
+	});
+
+	size_t header_size = 6;
+	size_t file_size = 0;
+
+	for(auto & job : jobs)
+	{
+		header_size += 8;
+
+		if(c16 && job.frame.height)
+		{
+			header_size += (job.frame.height - 1) * sizeof(uint32_t);
+		}
+
+		file_size += job.frame.data.size() * sizeof(uint16_t);
+	}
+
+	file_size += header_size;
+
+	std::vector<uchar> out(file_size);
+	writeLE<uint32_t>(out, 0, (c16? 0x02 : 0x00) | (_565? 0x01 : 0x00));
+	writeLE<uint16_t>(out, 4, jobs.size());
+
+//the headers and the line offset tables are filled in as each frame's data is placed
+	size_t pos = 6;
+	size_t offset = header_size;
+
+	for(auto & job : jobs)
+	{
+		const encoded_frame & frame = job.frame;
+
+		writeLE<uint32_t>(out, pos, offset);
+		writeLE<uint16_t>(out, pos + 4, frame.width);
+		writeLE<uint16_t>(out, pos + 6, frame.height);
+		pos += 8;
+
+		for(size_t y = 1; c16 && y < frame.lines.size(); ++y, pos += sizeof(uint32_t))
+		{
+			writeLE<uint32_t>(out, pos, offset + frame.lines[y] * sizeof(uint16_t));
+		}
+
+		memcpy(out.data() + offset, frame.data.data(), frame.data.size() * sizeof(uint16_t));
+		offset += frame.data.size() * sizeof(uint16_t);
+	}
+
+	QFile file(filename);
+
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		return false;
+	}
+
+	return file.write((const char *) out.data(), out.size()) == (qint64) out.size();
+}
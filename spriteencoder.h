@@ -0,0 +1,24 @@
+#ifndef SPRITEENCODER_H
+#define SPRITEENCODER_H
+#include <QImage>
+#include <vector>
+
+class QString;
+
+//one frame of a .c16/.s16 file, the counterpart of C16Decoder
+struct encoded_frame
+{
+	uint16_t width, height;
+//little endian words
+	std::vector<uint16_t> data;
+//c16 only, where each line starts in data
+	std::vector<uint32_t> lines;
+};
+
+//pixels with an alpha below 128 become transparent.
+encoded_frame encodeFrame(const QImage & image, bool c16, bool _565);
+
+//encodes the frames in parallel and writes the file in one go, including the line offset tables.
+bool writeC16File(const QString & filename, const std::vector<QImage> & frames, bool c16, bool _565);
+
+#endif // SPRITEENCODER_H
@@ -0,0 +1,45 @@
+#include "spritefile.h"
+#include "imageview.h"
+#include "byteswap.h"
+
+void writeSpriteFile(FILE * file, const std::vector<sprite_row> & rows)
+{
+	int _one = byte_swap((unsigned int) 1);
+
+	fwrite(&_one, 4, 1, file);
+	short size = byte_swap((short) rows.size());
+	fwrite(&size, sizeof(size), 1, file);
+
+	fpos_t header_pos;
+	fgetpos(file, &header_pos);
+	std::vector<image_header> header(rows.size());
+	fseek(file, header.size() * sizeof(image_header), SEEK_CUR);
+
+	for(size_t i = 0; i < rows.size(); ++i)
+	{
+		bool saved_metadata = false;
+
+		for(size_t j = 0; j < rows[i].size() && j < 5; ++j)
+		{
+			auto image = rows[i][j];
+
+			if(!image || image->image.isNull())
+			{
+				continue;
+			}
+
+			if(!saved_metadata)
+			{
+				saved_metadata      = true;
+				header[i].width     = byte_swap((uint16_t) image->image.width());
+				header[i].height    = byte_swap((uint16_t) image->image.height());
+			}
+
+			header[i].offset[j] = byte_swap((uint32_t) ftell(file));
+			image->writeImage(file);
+		}
+	}
+
+	fsetpos(file, &header_pos);
+	fwrite(header.data(), sizeof(image_header), header.size(), file);
+}
@@ -0,0 +1,20 @@
+#ifndef SPRITEFILE_H
+#define SPRITEFILE_H
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+class ImageView;
+
+struct image_header
+{
+	uint16_t width, height;
+	uint32_t offset[5];
+};
+
+//the maps (baked, albedo, ...) of one row of a .c32 file, entries may be 0L
+typedef std::vector<ImageView *> sprite_row;
+
+void writeSpriteFile(FILE * file, const std::vector<sprite_row> & rows);
+
+#endif // SPRITEFILE_H
@@ -7,11 +7,17 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QMenu>
+#include <QScrollBar>
+#include <QProgressDialog>
+#include <QtConcurrent>
 #include "spritebuilder.h"
 #include "imageview.h"
+#include "importpipeline.h"
+#include "reversedither.h"
 
 SpriteTable::SpriteTable(QWidget *parent)
-	: QTableWidget(parent)
+	: QTableWidget(parent),
+	import_progress(0L)
 {
 	setAcceptDrops(true);
 	verticalHeader()->setSectionsMovable(true);
@@ -20,16 +26,211 @@ SpriteTable::SpriteTable(QWidget *parent)
 
 	setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(this, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(customMenuRequested(QPoint)));
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(loadVisibleRows()));
+	connect(&import_watcher, SIGNAL(resultReadyAt(int)), this, SLOT(importFrameReady(int)));
+	connect(&import_watcher, SIGNAL(finished()), this, SLOT(importFinished()));
 }
 
 SpriteTable::SpriteTable(int rows, int columns, QWidget *parent)
-	: QTableWidget(rows, columns, parent)
+	: QTableWidget(rows, columns, parent),
+	import_progress(0L)
 {
 	setAcceptDrops(true);
 }
 
 SpriteTable::~SpriteTable()
 {
+	import_watcher.cancel();
+}
+
+void SpriteTable::appendRows(const std::vector<sprite_row> & rows)
+{
+	bool sorting = isSortingEnabled();
+	setSortingEnabled(false);
+	setUpdatesEnabled(false);
+
+	int first = rowCount();
+	setRowCount(first + rows.size());
+
+	for(size_t i = 0; i < rows.size(); ++i)
+	{
+		for(size_t j = 0; j < rows[i].size() && (int) j < columnCount(); ++j)
+		{
+			if(rows[i][j])
+			{
+				setItem(first + i, j, rows[i][j]);
+			}
+		}
+	}
+
+	resizeColumnsToContents();
+	resizeRowsToContents();
+
+	setSortingEnabled(sorting);
+	setUpdatesEnabled(true);
+}
+
+static
+QSharedPointer<pending_frame> decodePending(const QSharedPointer<pending_frame> & frame)
+{
+	frame->decode();
+	return frame;
+}
+
+void SpriteTable::importInBackground(const QString & title)
+{
+	cancelImport();
+
+//in the order the rows are shown so the top of the table fills in first
+	std::vector<QSharedPointer<pending_frame> > frames;
+
+	for(int i = 0; i < rowCount(); ++i)
+	{
+		for(int j = 0; j < columnCount(); ++j)
+		{
+			auto image = dynamic_cast<ImageView*>(item(verticalHeader()->logicalIndex(i), j));
+
+			if(image && !image->isLoaded())
+			{
+				frames.push_back(image->pendingFrame());
+			}
+		}
+	}
+
+	if(frames.empty())
+	{
+		return;
+	}
+
+	import_progress = new QProgressDialog(title, tr("Abort Import"), 0, frames.size(), this);
+	import_progress->setWindowModality(Qt::NonModal);
+	import_progress->setMinimumDuration(0);
+
+	connect(import_progress, SIGNAL(canceled()), this, SLOT(cancelImport()));
+	connect(&import_watcher, SIGNAL(progressValueChanged(int)), import_progress, SLOT(setValue(int)));
+
+	import_watcher.setFuture(QtConcurrent::mapped(frames, &decodePending));
+}
+
+void SpriteTable::cancelImport()
+{
+//frames already being decoded still finish on their own, nothing waits for them
+	import_watcher.cancel();
+	importFinished();
+}
+
+void SpriteTable::importFrameReady(int index)
+{
+	auto frame = import_watcher.resultAt(index);
+
+	if(frame->item)
+	{
+		frame->item->load();
+	}
+}
+
+void SpriteTable::importFinished()
+{
+	if(import_progress)
+	{
+		import_watcher.disconnect(import_progress);
+		import_progress->deleteLater();
+		import_progress = 0L;
+	}
+}
+
+ImageView * SpriteTable::imageAt(int row, int column)
+{
+	auto image = dynamic_cast<ImageView*>(item(row, column));
+
+	if(image)
+	{
+		image->load();
+	}
+
+	return image;
+}
+
+void SpriteTable::prefetchRow(int row)
+{
+	for(int j = 0; j < columnCount(); ++j)
+	{
+		auto image = dynamic_cast<ImageView*>(item(row, j));
+
+		if(image)
+		{
+			image->prefetch();
+		}
+	}
+}
+
+void SpriteTable::loadRow(int row)
+{
+	for(int j = 0; j < columnCount(); ++j)
+	{
+		imageAt(row, j);
+	}
+}
+
+void SpriteTable::loadAllRows()
+{
+	for(int i = 0; i < rowCount(); ++i)
+	{
+		prefetchRow(i);
+	}
+
+	for(int i = 0; i < rowCount(); ++i)
+	{
+		loadRow(i);
+	}
+}
+
+void SpriteTable::loadVisibleRows()
+{
+	if(rowCount() == 0)
+	{
+		return;
+	}
+
+	auto header = verticalHeader();
+	int first = std::max(0, header->visualIndexAt(0));
+	int last  = header->visualIndexAt(viewport()->height()-1);
+
+	if(last < 0)
+	{
+		last = rowCount()-1;
+	}
+
+	int page = last - first + 1;
+
+//decode what is on screen in parallel and wait for it, then start on a page either side of it.
+//during a background import the frames reach the table through importFrameReady instead, waiting
+//here could block the gui thread on a worker that is still decoding them.
+	for(int i = first; i <= last; ++i)
+	{
+		prefetchRow(header->logicalIndex(i));
+	}
+
+	for(int i = first; i <= last && !import_watcher.isRunning(); ++i)
+	{
+		loadRow(header->logicalIndex(i));
+	}
+
+	for(int i = std::max(0, first - page); i < first; ++i)
+	{
+		prefetchRow(header->logicalIndex(i));
+	}
+
+	for(int i = last+1; i < std::min(rowCount(), last + page + 1); ++i)
+	{
+		prefetchRow(header->logicalIndex(i));
+	}
+}
+
+void SpriteTable::resizeEvent(QResizeEvent * event)
+{
+	super::resizeEvent(event);
+	loadVisibleRows();
 }
 
 QImage SpriteTable::imageFromeMime(QMimeData * data)
@@ -144,7 +345,7 @@ bool SpriteTable::editReplaceImage(QImage & image, int row, int column)
 			continue;
 		}
 
-		auto it = dynamic_cast<ImageView*>(item(row, j));
+		auto it = imageAt(row, j);
 		if(it && !it->image.isNull())
 		{
 			if(it->bounds != n_box)
@@ -178,7 +379,7 @@ bool SpriteTable::editDelete(int row, int column)
 
 	for(uint8_t i = 0; i < columnCount(); ++i)
 	{
-		auto it = dynamic_cast<ImageView*>(item(row, i));
+		auto it = imageAt(row, i);
 
 		if(it && !it->image.isNull())
 		{
@@ -226,7 +427,7 @@ void SpriteTable::mousePressEvent(QMouseEvent * event)
 		return;
 	}
 
-	auto image = dynamic_cast<ImageView*>(item(row, column));
+	auto image = imageAt(row, column);
 	if(image == 0L || image->image.isNull())
 	{
 		return;
@@ -246,7 +447,7 @@ void SpriteTable::mousePressEvent(QMouseEvent * event)
 			continue;
 		}
 
-		auto it = dynamic_cast<ImageView*>(item(currentRow(), j));
+		auto it = imageAt(currentRow(), j);
 		if(it && !it->image.isNull())
 		{
 			if(it->bounds != n_box)
@@ -269,8 +470,6 @@ void SpriteTable::mousePressEvent(QMouseEvent * event)
 	}
 }
 
-QImage blur_colors(const QImage & original, int blur_iterations);
-
 void SpriteTable::toolsInterpolateColor()
 {
 	if(rowCount() == 0)
@@ -286,10 +485,12 @@ void SpriteTable::toolsInterpolateColor()
 		return;
 	}
 
+	loadAllRows();
+
 	auto action = new GroupCommand();
 	for(int i = 0; i < rowCount(); ++i)
 	{
-		ImageView * img = dynamic_cast<ImageView*>(item(i, 3));
+		ImageView * img = imageAt(i, 3);
 
 		if(!img || img->image.isNull())
 		{
@@ -309,8 +510,6 @@ void SpriteTable::toolsInterpolateColor()
 	}
 }
 
-QImage blur_alpha(const QImage & image, int alpha_iterations);
-
 void SpriteTable::toolsBlurAlpha()
 {
 	if(rowCount() == 0)
@@ -326,10 +525,12 @@ void SpriteTable::toolsBlurAlpha()
 		return;
 	}
 
+	loadAllRows();
+
 	auto action = new GroupCommand();
 	for(int i = 0; i < rowCount(); ++i)
 	{
-		ImageView * img = dynamic_cast<ImageView*>(item(i, 3));
+		ImageView * img = imageAt(i, 3);
 
 		if(!img || img->image.isNull())
 		{
@@ -349,7 +550,7 @@ void SpriteTable::toolsBlurAlpha()
 	}
 }
 
-QImage double_image(QImage image);
+QImage scale_image(QImage image, int factor, bool fixed);
 
 void SpriteTable::toolsScaleImages()
 {
@@ -358,19 +559,32 @@ void SpriteTable::toolsScaleImages()
 		return;
 	}
 
+	QStringList factors;
+	factors << tr("2x") << tr("4x") << tr("8x");
+
+	bool okay;
+	QString factor = QInputDialog::getItem(this, tr("Scale Sprites"), tr("Scale by?"), factors, 0, false, &okay);
+
+	if(!okay)
+	{
+		return;
+	}
+
+	loadAllRows();
+
 	auto action = new GroupCommand();
 	for(int i = 0; i < rowCount(); ++i)
 	{
 		for(int j = 0; j < columnCount(); ++j)
 		{
-			ImageView * img = dynamic_cast<ImageView*>(item(i, j));
+			ImageView * img = imageAt(i, j);
 
 			if(!img || img->image.isNull())
 			{
 				continue;
 			}
 
-			action->push_back(new SetCommand(this, i, j, double_image(img->image)));
+			action->push_back(new SetCommand(this, i, j, scale_image(img->image, 2 << factors.indexOf(factor), false)));
 		}
 	}
 
@@ -654,7 +868,7 @@ void SpriteTable::customMenuRequested(QPoint pos)
 {
 	QModelIndex index = indexAt(pos);
 
-	auto obj = dynamic_cast<ImageView*>(item(index.row(), index.column()));
+	auto obj = imageAt(index.row(), index.column());
 	bool exists = obj && !obj->image.isNull();
 
 	QMenu *menu=new QMenu(this);
@@ -1,9 +1,14 @@
 #ifndef SPRITETABLE_H
 #define SPRITETABLE_H
 #include <QTableWidget>
+#include <QFutureWatcher>
+#include <QSharedPointer>
 #include "commandchain.h"
+#include "spritefile.h"
 
 class ImageView;
+class QProgressDialog;
+struct pending_frame;
 
 class SpriteTable : public QTableWidget
 {
@@ -29,6 +34,18 @@ public:
 	bool editClear(int row, int column);
 	bool editDelete(int row, int column);
 
+//adds all the rows with updates and sorting suspended and lays the table out once,
+//items must have been created for the row they end up in (rowCount() + i).
+	void appendRows(const std::vector<sprite_row> & rows);
+
+//decodes the pending rows on the thread pool and fills them in as they finish, canceling
+//leaves whatever is left to be decoded when it is shown.
+	void importInBackground(const QString & title);
+
+//decodes the item first if it belongs to a lazy import
+	ImageView * imageAt(int row, int column);
+	void loadAllRows();
+
 	static
 	QImage imageFromeMime(QMimeData * data);
 	void mousePressEvent(QMouseEvent * event);
@@ -36,6 +53,7 @@ public:
 	void dropEvent(QDropEvent * event);
 	void dragMoveEvent(QDragMoveEvent * event);
 	void dragEnterEvent(QDragEnterEvent * event);
+	void resizeEvent(QResizeEvent * event);
 
 
 	void toolsClearRow(int row);
@@ -81,7 +99,20 @@ public slots:
 
 	void customMenuRequested(QPoint pos);
 
+	void loadVisibleRows();
+	void cancelImport();
+
+private slots:
+	void importFrameReady(int index);
+	void importFinished();
+
 private:
+	QFutureWatcher<QSharedPointer<pending_frame> > import_watcher;
+	QProgressDialog * import_progress;
+
+	void prefetchRow(int row);
+	void loadRow(int row);
+
 	bool loadImage(const QString &, QImage&);
 	bool saveImage(const QString &, const QImage&);
 	QImage openImage();
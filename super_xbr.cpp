@@ -2,6 +2,10 @@
 #include <cstdint>
 #include <cmath>
 #include "byteswap.h"
+#include "tilemap.h"
+#include "framearena.h"
+#include "imagebands.h"
+#include "simd.h"
 
 /*
 
@@ -32,7 +36,7 @@ THE SOFTWARE.
 #define USE_SQUARE 0
 
 static inline ALWAYS_INLINE
-float R(uint32_t _col)
+int R(uint32_t _col)
 {
 	int r = (_col >> 16) & 0xFF;
 #if USE_SQUARE
@@ -43,7 +47,7 @@ float R(uint32_t _col)
 }
 
 static inline ALWAYS_INLINE
-float G(uint32_t _col)
+int G(uint32_t _col)
 {
 	int r = (_col >> 8) & 0xFF;
 #if USE_SQUARE
@@ -54,7 +58,7 @@ float G(uint32_t _col)
 }
 
 static inline ALWAYS_INLINE
-float B(uint32_t _col)
+int B(uint32_t _col)
 {
 	int r = (_col) & 0xFF;
 #if USE_SQUARE
@@ -65,7 +69,7 @@ float B(uint32_t _col)
 }
 
 static inline ALWAYS_INLINE
-float A(uint32_t _col)
+int A(uint32_t _col)
 {
 	int r = (_col >> 24) & 0xFF;
 #if USE_SQUARE
@@ -82,23 +86,54 @@ static constexpr float w2  = (wgt1+0.5f);
 static constexpr float w3  = (-wgt2);
 static constexpr float w4  = (wgt2+0.5f);
 
+//the weights in 1.15 fixed point for the integer passes, u rounded and v = .5 - u.
+//the float passes take them as they are.
+template<class T>
+struct xbr_weights
+{
+	static constexpr float w1 = ::w1, w2 = ::w2, w3 = ::w3, w4 = ::w4;
+};
+
+template<>
+struct xbr_weights<int16_t>
+{
+	static constexpr int w1 = -4248, w2 = 16384 + 4248;
+	static constexpr int w3 = -5737, w4 = 16384 + 5737;
+};
+
 static
 float getLuminescence(float r, float g, float b)
 {
 	return 0.2126*r + 0.7152*g + 0.0722*b;
 }
 
+//the same luminance as a whole number, the weights out of 256
+static inline
+int getLuminescence(int r, int g, int b)
+{
+	return (54*r + 183*g + 19*b + 128) >> 8;
+}
+
+// the edge weights have always gone through the C abs(int), which drops the fractions; say so
+// rather than leave it to whichever overloads the headers happen to declare.
 float df(float A, float B)
+{
+	return abs((int) (A - B));
+}
+
+int df(int A, int B)
 {
 	return abs(A - B);
 }
 
-float min4(float a, float b, float c, float d)
+template<class T>
+T min4(T a, T b, T c, T d)
 {
 	return std::min(std::min(a,b),std::min(c, d));
 }
 
-float max4(float a, float b, float c, float d)
+template<class T>
+T max4(T a, T b, T c, T d)
 {
 	return std::max(std::max(a, b), std::max(c, d));
 }
@@ -109,12 +144,13 @@ T clamp(T x, T floor, T ceil)
 	return std::max(std::min(x, ceil), floor);
 }
 
+template<class T>
 static inline ALWAYS_INLINE
 uint32_t toColor(
-	const float min_r, const float max_r, float rf,
-	const float min_g, const float max_g, float gf,
-	const float min_b, const float max_b, float bf,
-	const float min_a, const float max_a, float af)
+	const T min_r, const T max_r, T rf,
+	const T min_g, const T max_g, T gf,
+	const T min_b, const T max_b, T bf,
+	const T min_a, const T max_a, T af)
 {
 	rf = clamp(rf, min_r, max_r);
 	gf = clamp(gf, min_g, max_g);
@@ -136,21 +172,22 @@ uint32_t toColor(
 	return ((int) ai << 24) | ((int) ri << 16) | ((int) gi << 8) | bi;
 }
 
+template<class T>
 static inline ALWAYS_INLINE
 uint32_t toColor(
-	const float r[4][4], const float rf,
-	const float g[4][4], const float gf,
-	const float b[4][4], const float bf,
-	const float a[4][4], const float af)
-{
-	float min_r_sample = min4(r[1][1], r[2][1], r[1][2], r[2][2]);
-	float min_g_sample = min4(g[1][1], g[2][1], g[1][2], g[2][2]);
-	float min_b_sample = min4(b[1][1], b[2][1], b[1][2], b[2][2]);
-	float min_a_sample = min4(a[1][1], a[2][1], a[1][2], a[2][2]);
-	float max_r_sample = max4(r[1][1], r[2][1], r[1][2], r[2][2]);
-	float max_g_sample = max4(g[1][1], g[2][1], g[1][2], g[2][2]);
-	float max_b_sample = max4(b[1][1], b[2][1], b[1][2], b[2][2]);
-	float max_a_sample = max4(a[1][1], a[2][1], a[1][2], a[2][2]);
+	const T r[4][4], const T rf,
+	const T g[4][4], const T gf,
+	const T b[4][4], const T bf,
+	const T a[4][4], const T af)
+{
+	T min_r_sample = min4(r[1][1], r[2][1], r[1][2], r[2][2]);
+	T min_g_sample = min4(g[1][1], g[2][1], g[1][2], g[2][2]);
+	T min_b_sample = min4(b[1][1], b[2][1], b[1][2], b[2][2]);
+	T min_a_sample = min4(a[1][1], a[2][1], a[1][2], a[2][2]);
+	T max_r_sample = max4(r[1][1], r[2][1], r[1][2], r[2][2]);
+	T max_g_sample = max4(g[1][1], g[2][1], g[1][2], g[2][2]);
+	T max_b_sample = max4(b[1][1], b[2][1], b[1][2], b[2][2]);
+	T max_a_sample = max4(a[1][1], a[2][1], a[1][2], a[2][2]);
 
 	return toColor(min_r_sample, max_r_sample, rf, min_g_sample, max_g_sample, gf, min_b_sample, max_b_sample, bf, min_a_sample, max_a_sample, af);
 }
@@ -189,15 +226,16 @@ sx, sy
 
 */
 
-float diagonal_edge(float mat[][4], float *wp) {
-	float dw1 = wp[0]*(df(mat[0][2], mat[1][1]) + df(mat[1][1], mat[2][0]) + df(mat[1][3], mat[2][2]) + df(mat[2][2], mat[3][1])) +\
+template<class T>
+T diagonal_edge(T mat[][4], T *wp) {
+	T dw1 = wp[0]*(df(mat[0][2], mat[1][1]) + df(mat[1][1], mat[2][0]) + df(mat[1][3], mat[2][2]) + df(mat[2][2], mat[3][1])) +\
 				wp[1]*(df(mat[0][3], mat[1][2]) + df(mat[2][1], mat[3][0])) + \
 				wp[2]*(df(mat[0][3], mat[2][1]) + df(mat[1][2], mat[3][0])) +\
 				wp[3]*df(mat[1][2], mat[2][1]) +\
 				wp[4]*(df(mat[0][2], mat[2][0]) + df(mat[1][3], mat[3][1])) +\
 				wp[5]*(df(mat[0][1], mat[1][0]) + df(mat[2][3], mat[3][2]));
 
-	float dw2 = wp[0]*(df(mat[0][1], mat[1][2]) + df(mat[1][2], mat[2][3]) + df(mat[1][0], mat[2][1]) + df(mat[2][1], mat[3][2])) +\
+	T dw2 = wp[0]*(df(mat[0][1], mat[1][2]) + df(mat[1][2], mat[2][3]) + df(mat[1][0], mat[2][1]) + df(mat[2][1], mat[3][2])) +\
 				wp[1]*(df(mat[0][0], mat[1][1]) + df(mat[2][2], mat[3][3])) +\
 				wp[2]*(df(mat[0][0], mat[2][2]) + df(mat[1][1], mat[3][3])) +\
 				wp[3]*df(mat[1][1], mat[2][2]) +\
@@ -237,160 +275,987 @@ void bilinear_filter(float u, float v,
 	a2 = u*(a[0][0] + a[3][3]) + v*(a[1][1] + a[2][2]);
 }
 
+//in fixed point, rounded to whole numbers
+static inline ALWAYS_INLINE
+int16_t bilinear(int u, int v, int a, int b)
+{
+	return (u*a + v*b + (1 << 14)) >> 15;
+}
+
+static inline ALWAYS_INLINE
+void bilinear_filter(int u, int v,
+	const int16_t r[][4], const int16_t g[][4], const int16_t b[][4], const int16_t a[][4],
+	int16_t & r1, int16_t &  g1, int16_t &  b1, int16_t &  a1,
+	int16_t &  r2, int16_t & g2, int16_t & b2, int16_t & a2)
+{
+	r1 = bilinear(u, v, r[0][3] + r[3][0], r[1][2] + r[2][1]);
+	g1 = bilinear(u, v, g[0][3] + g[3][0], g[1][2] + g[2][1]);
+	b1 = bilinear(u, v, b[0][3] + b[3][0], b[1][2] + b[2][1]);
+	a1 = bilinear(u, v, a[0][3] + a[3][0], a[1][2] + a[2][1]);
+	r2 = bilinear(u, v, r[0][0] + r[3][3], r[1][1] + r[2][2]);
+	g2 = bilinear(u, v, g[0][0] + g[3][3], g[1][1] + g[2][2]);
+	b2 = bilinear(u, v, b[0][0] + b[3][3], b[1][1] + b[2][2]);
+	a2 = bilinear(u, v, a[0][0] + a[3][3], a[1][1] + a[2][2]);
+}
+
 ///////////////////////// Super-xBR scaling
 // perform super-xbr (fast shader version) scaling by factor f=2 only.
+// each pass is split into the work for one spot so the vectorized version can share it at the edges.
+// T is float for the shader's math, or int16_t for whole numbers and fixed point weights that come out
+// the same everywhere.
+
+// First Pass: the pixel between four source pixels, their copies around it.
+template<int f, class T>
+static inline ALWAYS_INLINE
+void firstPass(const uint32_t* data, uint32_t* out, int w, int h, int x, int y) {
+	int outw = w*f;
+	T wp[6] = { 2, 1, -1, 4, -1, 1 };
+
+	T r[4][4], g[4][4], b[4][4], a[4][4], Y[4][4];
+	int cx = x / f, cy = y / f; // central pixels on original images
+	// sample supporting pixels in original image
+	for (int sx = -1; sx <= 2; ++sx) {
+		for (int sy = -1; sy <= 2; ++sy) {
+			// clamp pixel locations
+			int csy = clamp(sy + cy, 0, h - 1);
+			int csx = clamp(sx + cx, 0, w - 1);
+			// sample & add weighted components
+			uint32_t sample = data[csy*w + csx];
+			r[sx + 1][sy + 1] = R(sample);
+			g[sx + 1][sy + 1] = G(sample);
+			b[sx + 1][sy + 1] = B(sample);
+			a[sx + 1][sy + 1] = A(sample);
+			Y[sx + 1][sy + 1] = getLuminescence(r[sx + 1][sy + 1], g[sx + 1][sy + 1], b[sx + 1][sy + 1]);
+		}
+	}
+	T d_edge = diagonal_edge(Y, &wp[0]);
+
+	T r1, g1, b1, a1, r2, g2, b2, a2, rf, gf, bf, af;
+	bilinear_filter(xbr_weights<T>::w1, xbr_weights<T>::w2, r, g, b, a, r1, g1, b1, a1, r2, g2, b2, a2);
+
+	// generate and write result
+	if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
+	else { rf = r2; gf = g2; bf = b2; af = a2; }
+	// anti-ringing, clamp.
+	out[y*outw + x] = out[y*outw + x + 1] = out[(y + 1)*outw + x] = data[cy*w + cx];
+	out[(y+1)*outw + x+1] = toColor(r, rf, g, gf, b, bf, a, af);
+}
+
+// Second Pass: the pixels right of and below a source pixel, from the diagonals around them.
+template<int f, class T>
+static inline ALWAYS_INLINE
+void secondPass(uint32_t* out, int w, int h, int x, int y) {
+	int outw = w*f;
+	T wp[6] = { 2, 0, 0, 0, 0, 0 };
+
+	T r[4][4], g[4][4], b[4][4], a[4][4], Y[4][4];
+	// sample supporting pixels in original image
+	for (int sx = -1; sx <= 2; ++sx) {
+		for (int sy = -1; sy <= 2; ++sy) {
+			// clamp pixel locations
+			int csy = clamp(sx - sy + y, 0, f*h - 1);
+			int csx = clamp(sx + sy + x, 0, f*w - 1);
+			// sample & add weighted components
+			uint32_t sample = out[csy*outw + csx];
+			r[sx + 1][sy + 1] = R(sample);
+			g[sx + 1][sy + 1] = G(sample);
+			b[sx + 1][sy + 1] = B(sample);
+			a[sx + 1][sy + 1] = A(sample);
+			Y[sx + 1][sy + 1] = getLuminescence(r[sx + 1][sy + 1], g[sx + 1][sy + 1], b[sx + 1][sy + 1]);
+		}
+	}
+
+	T d_edge = diagonal_edge(Y, &wp[0]);
+	T r1, g1, b1, a1, r2, g2, b2, a2, rf, gf, bf, af;
+	bilinear_filter(xbr_weights<T>::w3, xbr_weights<T>::w4, r, g, b, a,  r1, g1, b1, a1, r2, g2, b2, a2);
+
+	// generate and write result
+	if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
+	else { rf = r2; gf = g2; bf = b2; af = a2; }
+
+	T min_r_sample = min4(r[1][1], r[2][1], r[1][2], r[2][2]);
+	T min_g_sample = min4(g[1][1], g[2][1], g[1][2], g[2][2]);
+	T min_b_sample = min4(b[1][1], b[2][1], b[1][2], b[2][2]);
+	T min_a_sample = min4(a[1][1], a[2][1], a[1][2], a[2][2]);
+	T max_r_sample = max4(r[1][1], r[2][1], r[1][2], r[2][2]);
+	T max_g_sample = max4(g[1][1], g[2][1], g[1][2], g[2][2]);
+	T max_b_sample = max4(b[1][1], b[2][1], b[1][2], b[2][2]);
+	T max_a_sample = max4(a[1][1], a[2][1], a[1][2], a[2][2]);
+	out[y*outw + x+1] = toColor(min_r_sample, max_r_sample, rf, min_g_sample, max_g_sample, gf, min_b_sample, max_b_sample, bf, min_a_sample, max_a_sample, af);
+
+	for (int sx = -1; sx <= 2; ++sx) {
+		for (int sy = -1; sy <= 2; ++sy) {
+			// clamp pixel locations
+			int csy = clamp(sx - sy + 1 + y, 0, f*h - 1);
+			int csx = clamp(sx + sy - 1 + x, 0, f*w - 1);
+			// sample & add weighted components
+			uint32_t sample = out[csy*outw + csx];
+			r[sx + 1][sy + 1] = R(sample);
+			g[sx + 1][sy + 1] = G(sample);
+			b[sx + 1][sy + 1] = B(sample);
+			a[sx + 1][sy + 1] = A(sample);
+			Y[sx + 1][sy + 1] = getLuminescence(r[sx + 1][sy + 1], g[sx + 1][sy + 1], b[sx + 1][sy + 1]);
+		}
+	}
+	d_edge = diagonal_edge(Y, &wp[0]);
+	bilinear_filter(xbr_weights<T>::w3, xbr_weights<T>::w4, r, g, b, a,  r1, g1, b1, a1, r2, g2, b2, a2);
+	// generate and write result
+	if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
+	else { rf = r2; gf = g2; bf = b2; af = a2; }
+
+	out[(y+1)*outw + x] = toColor(min_r_sample, max_r_sample, rf, min_g_sample, max_g_sample, gf, min_b_sample, max_b_sample, bf, min_a_sample, max_a_sample, af);
+}
+
+// Third Pass: every pixel again from the 4x4 around it. it works in place from the bottom right,
+// so sample(x, y) sees the pixels below and to the right already done.
+template<int f, class T, typename Sample>
+static inline ALWAYS_INLINE
+uint32_t thirdPass(Sample sample, int w, int h, int x, int y) {
+	T wp[6] = { 2, 1, -1, 4, -1, 1 };
+
+	T r[4][4], g[4][4], b[4][4], a[4][4], Y[4][4];
+	for (int sx = -2; sx <= 1; ++sx) {
+		for (int sy = -2; sy <= 1; ++sy) {
+			// clamp pixel locations
+			int csy = clamp(sy + y, 0, f*h - 1);
+			int csx = clamp(sx + x, 0, f*w - 1);
+			// sample & add weighted components
+			uint32_t c = sample(csx, csy);
+			r[sx + 2][sy + 2] = R(c);
+			g[sx + 2][sy + 2] = G(c);
+			b[sx + 2][sy + 2] = B(c);
+			a[sx + 2][sy + 2] = A(c);
+			Y[sx + 2][sy + 2] = getLuminescence(r[sx + 2][sy + 2], g[sx + 2][sy + 2], b[sx + 2][sy + 2]);
+		}
+	}
+	T d_edge = diagonal_edge(Y, &wp[0]);
+	T r1, g1, b1, a1, r2, g2, b2, a2, rf, gf, bf, af;
+	bilinear_filter(xbr_weights<T>::w3, xbr_weights<T>::w4, r, g, b, a,  r1, g1, b1, a1, r2, g2, b2, a2);
+
+	// generate and write result
+	if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
+	else { rf = r2; gf = g2; bf = b2; af = a2; }
+
+	return toColor(r, rf, g, gf, b, bf, a, af);
+}
+
+// a source tile that is clear along with its neighbors scales to clear pixels: every output is clamped
+// to samples no more than two pixels away, so the first pass writes zeros and the others skip it.
 template<int f>
-void scaleSuperXBRT(uint32_t* data, uint32_t* out, int w, int h) {
+static inline ALWAYS_INLINE
+bool clearTile(const tile_map & tiles, int x, int y) {
+	return tiles.quietRow(y / f)[(x / f) >> TILE_SHIFT] & TILE_CLEAR;
+}
+
+static inline
+int floorDiv3(int n)
+{
+	return n >= 0? n / 3 : -((2 - n) / 3);
+}
+
+//the second pass's windows only clamp within two source pixels of the edge, where they can land on
+//the edge pixels the pass itself writes. the cells inside that don't touch each other and go in bands,
+//the rest go afterwards in their old order.
+template<int f, class T>
+static
+void secondPassEdges(uint32_t * out, int w, int h, const tile_map & tiles)
+{
+	for(int cy = 0; cy < h; ++cy)
+	{
+		for(int cx = 0; cx < w; ++cx)
+		{
+			if(cy >= 2 && cy <= h - 3 && cx >= 2 && cx <= w - 3)
+			{
+				cx = w - 3;
+				continue;
+			}
+
+			if(!clearTile<f>(tiles, cx*f, cy*f))
+			{
+				secondPass<f, T>(out, w, h, cx*f, cy*f);
+			}
+		}
+	}
+}
+
+//lines first down to last of x + 3y, on rows [begin, end)
+struct xbr_block
+{
+	int first, last;
+	int begin, end;
+};
+
+//the third pass works in place, and a pixel reads the ones in its row and the row below that are
+//already done, the rest from before. all of those it has to come after have a larger x + 3y in its row
+//or the two below it, all it has to come before a smaller one in its row or the two above.
+//so the pass can go over blocks of lines and bands of rows: the blocks on one diagonal of that grid never
+//read each other, and the diagonals go one after the other on the pool from the bottom right.
+template<typename F>
+static
+void forEachWave(int outw, int outh, F f)
+{
+	const int lines = outw + 3 * (outh - 1);
+	const int bands = std::max(1, std::min(QThreadPool::globalInstance()->maxThreadCount(), outh / 64));
+
+	if(bands == 1)
+	{
+		f(xbr_block{ lines - 1, 0, 0, outh });
+		return;
+	}
+
+	const int chunks = bands * 4;
+	std::vector<xbr_block> wave;
+
+	for(int t = 1 - bands; t < chunks; ++t)
+	{
+		wave.clear();
+
+		for(int b = 0; b < bands; ++b)
+		{
+			int c = t + b;
+			xbr_block block{ lines - 1 - lines * c / chunks, lines - lines * (c+1) / chunks, outh * b / bands, outh * (b+1) / bands };
+
+//blocks with no pixels: the lines pass below or above the band
+			if(c >= 0 && c < chunks && block.first >= 3 * block.begin && block.last <= 3 * (block.end - 1) + outw - 1)
+			{
+				wave.push_back(block);
+			}
+		}
+
+		QtConcurrent::blockingMap(wave, [&f](const xbr_block & block) { f(block); });
+	}
+}
+
+//the rows of line k that are in the frame, clipped to [begin, end)
+static inline
+void lineRows(int k, int outw, int outh, int begin, int end, int & first, int & last)
+{
+	first = std::max(begin, -floorDiv3(outw - 1 - k));
+	last  = std::min(std::min(outh, end) - 1, k / 3);
+}
+
+template<int f, class T>
+void scaleSuperXBRT(const uint32_t* data, uint32_t* out, int w, int h, const tile_map & tiles) {
 	int outw = w*f, outh = h*f;
 
-	float wp[6] = { 2.0f, 1.0f, -1.0f, 4.0f, -1.0f, 1.0f };
-
-	// First Pass
-	for (int y = 0; y < outh; y += f) {
-		for (int x = 0; x < outw; x += f) {
-			float r[4][4], g[4][4], b[4][4], a[4][4], Y[4][4];
-			int cx = x / f, cy = y / f; // central pixels on original images
-			// sample supporting pixels in original image
-			for (int sx = -1; sx <= 2; ++sx) {
-				for (int sy = -1; sy <= 2; ++sy) {
-					// clamp pixel locations
-					int csy = clamp(sy + cy, 0, h - 1);
-					int csx = clamp(sx + cx, 0, w - 1);
-					// sample & add weighted components
-					uint32_t sample = data[csy*w + csx];
-					r[sx + 1][sy + 1] = R(sample);
-					g[sx + 1][sy + 1] = G(sample);
-					b[sx + 1][sy + 1] = B(sample);
-					a[sx + 1][sy + 1] = A(sample);
-					Y[sx + 1][sy + 1] = getLuminescence(r[sx + 1][sy + 1], g[sx + 1][sy + 1], b[sx + 1][sy + 1]);
+	forEachBand(h, [=, &tiles](int begin, int end) {
+		for (int y = begin*f; y < end*f; y += f) {
+			for (int x = 0; x < outw; x += f) {
+				if (clearTile<f>(tiles, x, y)) {
+					out[y*outw + x] = out[y*outw + x + 1] = out[(y + 1)*outw + x] = out[(y+1)*outw + x+1] = 0;
+					continue;
 				}
+				firstPass<f, T>(data, out, w, h, x, y);
 			}
-			float d_edge = diagonal_edge(Y, &wp[0]);
+		}
+		return 0;
+	}, 32);
+
+	forEachBand(h, [=, &tiles](int begin, int end) {
+		for (int y = std::max(begin, 2)*f; y < std::min(end, h - 2)*f; y += f) {
+			for (int x = 2*f; x < (w - 2)*f; x += f) {
+				if (clearTile<f>(tiles, x, y)) continue;
+				secondPass<f, T>(out, w, h, x, y);
+			}
+		}
+		return 0;
+	}, 32);
+
+	secondPassEdges<f, T>(out, w, h, tiles);
+
+	auto sample = [out, outw](int x, int y) { return out[y*outw + x]; };
+
+	forEachWave(outw, outh, [=, &tiles](const xbr_block & block) {
+		for (int k = block.first; k >= block.last; --k) {
+			int first, last;
+			lineRows(k, outw, outh, block.begin, block.end, first, last);
+			for (int y = first; y <= last; ++y) {
+				int x = k - 3*y;
+				if (clearTile<f>(tiles, x, y)) continue;
+				out[y*outw + x] = thirdPass<f, T>(sample, w, h, x, y);
+			}
+		}
+	});
+
+}
+
+//// *** Super-xBR code ends here - MIT LICENSE *** ///
+
+#if HAVE_X86_SIMD
+
+//the same passes 8 pixels at a time from planar channels, which are split out of the pixels once
+//instead of for every window they fall in. for floats the luminance is still worked out in double and
+//the edge weights are whole numbers, so every lane comes out exactly as the scalar passes would have it.
+//the integer passes keep their channels in 16 bits and match the scalar ones trivially.
+enum { XBR_R, XBR_G, XBR_B, XBR_A, XBR_Y, XBR_PLANES };
+
+//where the 16 samples of the windows of a run of 8 pixels start, relative to the first pixel,
+//indexed [sx][sy] like the scalar passes. each channel is `plane` samples after the one before.
+struct xbr_window
+{
+	ptrdiff_t offset[4][4];
+	ptrdiff_t plane;
+};
+
+template<class T>
+static inline ALWAYS_INLINE
+void splitPixel(uint32_t c, T * p, ptrdiff_t plane)
+{
+	p[XBR_R*plane] = R(c);
+	p[XBR_G*plane] = G(c);
+	p[XBR_B*plane] = B(c);
+	p[XBR_A*plane] = A(c);
+	p[XBR_Y*plane] = getLuminescence(p[XBR_R*plane], p[XBR_G*plane], p[XBR_B*plane]);
+}
 
-			float r1, g1, b1, a1, r2, g2, b2, a2, rf, gf, bf, af;
-			bilinear_filter(w1, w2, r, g, b, a, r1, g1, b1, a1, r2, g2, b2, a2);
+static inline
+__m256 TARGET("avx2") ALWAYS_INLINE sample8(const float * p, const xbr_window & win, int c, int sx, int sy)
+{
+	return _mm256_loadu_ps(p + win.offset[sx][sy] + c * win.plane);
+}
+
+static inline
+__m256 TARGET("avx2") ALWAYS_INLINE df8(__m256 a, __m256 b)
+{
+	__m256 d = _mm256_round_ps(_mm256_sub_ps(a, b), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), d);
+}
 
-			// generate and write result
-			if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
-			else { rf = r2; gf = g2; bf = b2; af = a2; }
-			// anti-ringing, clamp.
-			out[y*outw + x] = out[y*outw + x + 1] = out[(y + 1)*outw + x] = data[cy*w + cx];
-			out[(y+1)*outw + x+1] = toColor(r, rf, g, gf, b, bf, a, af);
+//diagonal_edge(), with only its first weight in the second pass
+template<bool second_pass>
+static inline
+__m256 TARGET("avx2") ALWAYS_INLINE diagonalEdge8(const float * p, const xbr_window & win)
+{
+	__m256 m[4][4];
+	for(int sx = 0; sx < 4; ++sx)
+	{
+		for(int sy = 0; sy < 4; ++sy)
+		{
+			m[sx][sy] = sample8(p, win, XBR_Y, sx, sy);
 		}
 	}
 
-	// Second Pass
-	wp[0] = 2.0f;
-	wp[1] = 0.0f;
-	wp[2] = 0.0f;
-	wp[3] = 0.0f;
-	wp[4] = 0.0f;
-	wp[5] = 0.0f;
-
-	for (int y = 0; y < outh; y += f) {
-		for (int x = 0; x < outw; x += f) {
-			float r[4][4], g[4][4], b[4][4], a[4][4], Y[4][4];
-			// sample supporting pixels in original image
-			for (int sx = -1; sx <= 2; ++sx) {
-				for (int sy = -1; sy <= 2; ++sy) {
-					// clamp pixel locations
-					int csy = clamp(sx - sy + y, 0, f*h - 1);
-					int csx = clamp(sx + sy + x, 0, f*w - 1);
-					// sample & add weighted components
-					uint32_t sample = out[csy*outw + csx];
-					r[sx + 1][sy + 1] = R(sample);
-					g[sx + 1][sy + 1] = G(sample);
-					b[sx + 1][sy + 1] = B(sample);
-					a[sx + 1][sy + 1] = A(sample);
-					Y[sx + 1][sy + 1] = getLuminescence(r[sx + 1][sy + 1], g[sx + 1][sy + 1], b[sx + 1][sy + 1]);
-				}
+	__m256 dw1 = _mm256_add_ps(_mm256_add_ps(df8(m[0][2], m[1][1]), df8(m[1][1], m[2][0])), _mm256_add_ps(df8(m[1][3], m[2][2]), df8(m[2][2], m[3][1])));
+	__m256 dw2 = _mm256_add_ps(_mm256_add_ps(df8(m[0][1], m[1][2]), df8(m[1][2], m[2][3])), _mm256_add_ps(df8(m[1][0], m[2][1]), df8(m[2][1], m[3][2])));
+	dw1 = _mm256_mul_ps(_mm256_set1_ps(2.0f), dw1);
+	dw2 = _mm256_mul_ps(_mm256_set1_ps(2.0f), dw2);
+
+	if(!second_pass)
+	{
+//weights 1, -1, 4, -1, 1
+		dw1 = _mm256_add_ps(dw1, _mm256_add_ps(df8(m[0][3], m[1][2]), df8(m[2][1], m[3][0])));
+		dw1 = _mm256_sub_ps(dw1, _mm256_add_ps(df8(m[0][3], m[2][1]), df8(m[1][2], m[3][0])));
+		dw1 = _mm256_add_ps(dw1, _mm256_mul_ps(_mm256_set1_ps(4.0f), df8(m[1][2], m[2][1])));
+		dw1 = _mm256_sub_ps(dw1, _mm256_add_ps(df8(m[0][2], m[2][0]), df8(m[1][3], m[3][1])));
+		dw1 = _mm256_add_ps(dw1, _mm256_add_ps(df8(m[0][1], m[1][0]), df8(m[2][3], m[3][2])));
+
+		dw2 = _mm256_add_ps(dw2, _mm256_add_ps(df8(m[0][0], m[1][1]), df8(m[2][2], m[3][3])));
+		dw2 = _mm256_sub_ps(dw2, _mm256_add_ps(df8(m[0][0], m[2][2]), df8(m[1][1], m[3][3])));
+		dw2 = _mm256_add_ps(dw2, _mm256_mul_ps(_mm256_set1_ps(4.0f), df8(m[1][1], m[2][2])));
+		dw2 = _mm256_sub_ps(dw2, _mm256_add_ps(df8(m[1][0], m[3][2]), df8(m[0][1], m[2][3])));
+		dw2 = _mm256_add_ps(dw2, _mm256_add_ps(df8(m[0][2], m[1][3]), df8(m[2][0], m[3][1])));
+	}
+
+	return _mm256_sub_ps(dw1, dw2);
+}
+
+//the edge test and bilinear_filter(), before the anti-ringing clamp
+template<bool second_pass>
+static inline
+void TARGET("avx2") ALWAYS_INLINE filter8(const float * p, const xbr_window & win, float u, float v, __m256 f[4])
+{
+	const __m256 mu = _mm256_set1_ps(u);
+	const __m256 mv = _mm256_set1_ps(v);
+	__m256 first = _mm256_cmp_ps(diagonalEdge8<second_pass>(p, win), _mm256_setzero_ps(), _CMP_LE_OQ);
+
+	for(int c = XBR_R; c <= XBR_A; ++c)
+	{
+		__m256 f1 = _mm256_add_ps(
+			_mm256_mul_ps(mu, _mm256_add_ps(sample8(p, win, c, 0, 3), sample8(p, win, c, 3, 0))),
+			_mm256_mul_ps(mv, _mm256_add_ps(sample8(p, win, c, 1, 2), sample8(p, win, c, 2, 1))));
+		__m256 f2 = _mm256_add_ps(
+			_mm256_mul_ps(mu, _mm256_add_ps(sample8(p, win, c, 0, 0), sample8(p, win, c, 3, 3))),
+			_mm256_mul_ps(mv, _mm256_add_ps(sample8(p, win, c, 1, 1), sample8(p, win, c, 2, 2))));
+		f[c] = _mm256_blendv_ps(f2, f1, first);
+	}
+}
+
+//the range of the four samples in the middle of the window
+static inline
+void TARGET("avx2") ALWAYS_INLINE bounds8(const float * p, const xbr_window & win, __m256 lo[4], __m256 hi[4])
+{
+	for(int c = XBR_R; c <= XBR_A; ++c)
+	{
+		__m256 a = sample8(p, win, c, 1, 1), b = sample8(p, win, c, 2, 1);
+		__m256 d = sample8(p, win, c, 1, 2), e = sample8(p, win, c, 2, 2);
+		lo[c] = _mm256_min_ps(_mm256_min_ps(a, b), _mm256_min_ps(d, e));
+		hi[c] = _mm256_max_ps(_mm256_max_ps(a, b), _mm256_max_ps(d, e));
+	}
+}
+
+//toColor(): clamped, rounded half up into ARGB words, with the rounded channels left in f
+static inline
+__m256i TARGET("avx2") ALWAYS_INLINE toColor8(__m256 f[4], const __m256 lo[4], const __m256 hi[4])
+{
+	__m256i c[4];
+
+	for(int i = XBR_R; i <= XBR_A; ++i)
+	{
+		__m256 x = _mm256_max_ps(_mm256_min_ps(f[i], hi[i]), lo[i]);
+		__m256 whole = _mm256_floor_ps(x);
+		__m256 up = _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(x, whole), _mm256_set1_ps(0.5f), _CMP_GE_OQ), _mm256_set1_ps(1.0f));
+		f[i] = _mm256_add_ps(whole, up);
+		c[i] = _mm256_cvttps_epi32(f[i]);
+	}
+
+	return _mm256_or_si256(
+		_mm256_or_si256(_mm256_slli_epi32(c[XBR_A], 24), _mm256_slli_epi32(c[XBR_R], 16)),
+		_mm256_or_si256(_mm256_slli_epi32(c[XBR_G], 8), c[XBR_B]));
+}
+
+static inline
+__m256 TARGET("avx2") ALWAYS_INLINE luminance8(const __m256 f[4])
+{
+	__m128 half[2];
+
+	for(int i = 0; i < 2; ++i)
+	{
+		__m256d r = _mm256_cvtps_pd(i? _mm256_extractf128_ps(f[XBR_R], 1) : _mm256_castps256_ps128(f[XBR_R]));
+		__m256d g = _mm256_cvtps_pd(i? _mm256_extractf128_ps(f[XBR_G], 1) : _mm256_castps256_ps128(f[XBR_G]));
+		__m256d b = _mm256_cvtps_pd(i? _mm256_extractf128_ps(f[XBR_B], 1) : _mm256_castps256_ps128(f[XBR_B]));
+		__m256d y = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(0.2126), r), _mm256_mul_pd(_mm256_set1_pd(0.7152), g)), _mm256_mul_pd(_mm256_set1_pd(0.0722), b));
+		half[i] = _mm256_cvtpd_ps(y);
+	}
+
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(half[0]), half[1], 1);
+}
+
+//the words of a and b alternating, a first
+static inline
+void TARGET("avx2") ALWAYS_INLINE interleave8(__m256i a, __m256i b, __m256i & lo, __m256i & hi)
+{
+	__m256i l = _mm256_unpacklo_epi32(a, b);
+	__m256i h = _mm256_unpackhi_epi32(a, b);
+	lo = _mm256_permute2x128_si256(l, h, 0x20);
+	hi = _mm256_permute2x128_si256(l, h, 0x31);
+}
+
+//the integer passes, in 16 bit lanes. luminance differences are at most 255 and the edge sums 16 of
+//those, the filters are worked out in 32 bits and narrowed once they are whole numbers.
+static inline
+__m128i TARGET("avx2") ALWAYS_INLINE sample8(const int16_t * p, const xbr_window & win, int c, int sx, int sy)
+{
+	return _mm_loadu_si128((const __m128i *) (p + win.offset[sx][sy] + c * win.plane));
+}
+
+static inline
+__m128i TARGET("avx2") ALWAYS_INLINE df8(__m128i a, __m128i b)
+{
+	return _mm_abs_epi16(_mm_sub_epi16(a, b));
+}
+
+template<bool second_pass>
+static inline
+__m128i TARGET("avx2") ALWAYS_INLINE diagonalEdge8(const int16_t * p, const xbr_window & win)
+{
+	__m128i m[4][4];
+	for(int sx = 0; sx < 4; ++sx)
+	{
+		for(int sy = 0; sy < 4; ++sy)
+		{
+			m[sx][sy] = sample8(p, win, XBR_Y, sx, sy);
+		}
+	}
+
+	__m128i dw1 = _mm_add_epi16(_mm_add_epi16(df8(m[0][2], m[1][1]), df8(m[1][1], m[2][0])), _mm_add_epi16(df8(m[1][3], m[2][2]), df8(m[2][2], m[3][1])));
+	__m128i dw2 = _mm_add_epi16(_mm_add_epi16(df8(m[0][1], m[1][2]), df8(m[1][2], m[2][3])), _mm_add_epi16(df8(m[1][0], m[2][1]), df8(m[2][1], m[3][2])));
+	dw1 = _mm_slli_epi16(dw1, 1);
+	dw2 = _mm_slli_epi16(dw2, 1);
+
+	if(!second_pass)
+	{
+		dw1 = _mm_add_epi16(dw1, _mm_add_epi16(df8(m[0][3], m[1][2]), df8(m[2][1], m[3][0])));
+		dw1 = _mm_sub_epi16(dw1, _mm_add_epi16(df8(m[0][3], m[2][1]), df8(m[1][2], m[3][0])));
+		dw1 = _mm_add_epi16(dw1, _mm_slli_epi16(df8(m[1][2], m[2][1]), 2));
+		dw1 = _mm_sub_epi16(dw1, _mm_add_epi16(df8(m[0][2], m[2][0]), df8(m[1][3], m[3][1])));
+		dw1 = _mm_add_epi16(dw1, _mm_add_epi16(df8(m[0][1], m[1][0]), df8(m[2][3], m[3][2])));
+
+		dw2 = _mm_add_epi16(dw2, _mm_add_epi16(df8(m[0][0], m[1][1]), df8(m[2][2], m[3][3])));
+		dw2 = _mm_sub_epi16(dw2, _mm_add_epi16(df8(m[0][0], m[2][2]), df8(m[1][1], m[3][3])));
+		dw2 = _mm_add_epi16(dw2, _mm_slli_epi16(df8(m[1][1], m[2][2]), 2));
+		dw2 = _mm_sub_epi16(dw2, _mm_add_epi16(df8(m[1][0], m[3][2]), df8(m[0][1], m[2][3])));
+		dw2 = _mm_add_epi16(dw2, _mm_add_epi16(df8(m[0][2], m[1][3]), df8(m[2][0], m[3][1])));
+	}
+
+	return _mm_sub_epi16(dw1, dw2);
+}
+
+//bilinear(), with u and v packed into each 32 bit lane
+static inline
+__m128i TARGET("avx2") ALWAYS_INLINE bilinear8(__m128i a, __m128i b, __m128i uv)
+{
+	const __m128i half = _mm_set1_epi32(1 << 14);
+	__m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), uv), half), 15);
+	__m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), uv), half), 15);
+	return _mm_packs_epi32(lo, hi);
+}
+
+template<bool second_pass>
+static inline
+void TARGET("avx2") ALWAYS_INLINE filter8(const int16_t * p, const xbr_window & win, int u, int v, __m128i f[4])
+{
+	const __m128i uv = _mm_set1_epi32((v << 16) | (u & 0xFFFF));
+	__m128i second = _mm_cmpgt_epi16(diagonalEdge8<second_pass>(p, win), _mm_setzero_si128());
+
+	for(int c = XBR_R; c <= XBR_A; ++c)
+	{
+		__m128i f1 = bilinear8(
+			_mm_add_epi16(sample8(p, win, c, 0, 3), sample8(p, win, c, 3, 0)),
+			_mm_add_epi16(sample8(p, win, c, 1, 2), sample8(p, win, c, 2, 1)), uv);
+		__m128i f2 = bilinear8(
+			_mm_add_epi16(sample8(p, win, c, 0, 0), sample8(p, win, c, 3, 3)),
+			_mm_add_epi16(sample8(p, win, c, 1, 1), sample8(p, win, c, 2, 2)), uv);
+		f[c] = _mm_blendv_epi8(f1, f2, second);
+	}
+}
+
+static inline
+void TARGET("avx2") ALWAYS_INLINE bounds8(const int16_t * p, const xbr_window & win, __m128i lo[4], __m128i hi[4])
+{
+	for(int c = XBR_R; c <= XBR_A; ++c)
+	{
+		__m128i a = sample8(p, win, c, 1, 1), b = sample8(p, win, c, 2, 1);
+		__m128i d = sample8(p, win, c, 1, 2), e = sample8(p, win, c, 2, 2);
+		lo[c] = _mm_min_epi16(_mm_min_epi16(a, b), _mm_min_epi16(d, e));
+		hi[c] = _mm_max_epi16(_mm_max_epi16(a, b), _mm_max_epi16(d, e));
+	}
+}
+
+//the channels are already whole, only the clamp is left
+static inline
+__m256i TARGET("avx2") ALWAYS_INLINE toColor8(__m128i f[4], const __m128i lo[4], const __m128i hi[4])
+{
+	for(int i = XBR_R; i <= XBR_A; ++i)
+	{
+		f[i] = _mm_max_epi16(_mm_min_epi16(f[i], hi[i]), lo[i]);
+	}
+
+	__m128i bg = _mm_or_si128(f[XBR_B], _mm_slli_epi16(f[XBR_G], 8));
+	__m128i ra = _mm_or_si128(f[XBR_R], _mm_slli_epi16(f[XBR_A], 8));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(bg, ra)), _mm_unpackhi_epi16(bg, ra), 1);
+}
+
+//the sum can pass 32767 but not 65535, so it is taken as unsigned
+static inline
+__m128i TARGET("avx2") ALWAYS_INLINE luminance8(const __m128i f[4])
+{
+	__m128i y = _mm_add_epi16(
+		_mm_add_epi16(_mm_mullo_epi16(f[XBR_R], _mm_set1_epi16(54)), _mm_mullo_epi16(f[XBR_G], _mm_set1_epi16(183))),
+		_mm_add_epi16(_mm_mullo_epi16(f[XBR_B], _mm_set1_epi16(19)), _mm_set1_epi16(128)));
+	return _mm_srli_epi16(y, 8);
+}
+
+static inline
+void TARGET("avx2") ALWAYS_INLINE store8(float * p, __m256 v)
+{
+	_mm256_storeu_ps(p, v);
+}
+
+static inline
+void TARGET("avx2") ALWAYS_INLINE store8(int16_t * p, __m128i v)
+{
+	_mm_storeu_si128((__m128i *) p, v);
+}
+
+//a run of 8 samples of either kind
+template<class T> struct xbr_vector;
+template<> struct xbr_vector<float>   { typedef __m256 type; };
+template<> struct xbr_vector<int16_t> { typedef __m128i type; };
+
+//a run of 8 cells is skipped when both tiles it touches are
+static inline
+bool clearRun(const tile_map & tiles, int x, int y)
+{
+	return clearTile<2>(tiles, x, y) && clearTile<2>(tiles, x + 14, y);
+}
+
+//the source or the first pass's diagonals as five planes, with a border of one before and two after
+//that repeats the edges the way the scalar passes clamp them
+template<class T>
+struct xbr_planes
+{
+	T * source;
+	T * diagonals;
+	int stride;
+	ptrdiff_t plane;
+};
+
+template<class T>
+static
+void TARGET("avx2") firstPassAvx2(const uint32_t * data, uint32_t * out, int w, int h, const tile_map & tiles, const xbr_planes<T> & planes, int begin, int end)
+{
+	const int outw = w*2;
+	const int pw = planes.stride;
+
+	xbr_window win;
+	win.plane = planes.plane;
+
+	for(int sx = 0; sx < 4; ++sx)
+	{
+		for(int sy = 0; sy < 4; ++sy)
+		{
+			win.offset[sx][sy] = (sx - 1) + (sy - 1) * pw;
+		}
+	}
+
+	for(int y = begin; y < end; ++y)
+	{
+		int x = 0;
+		for(; x + 8 <= w; x += 8)
+		{
+			__m256i * row0 = (__m256i *) (out + (y*2) * outw + x*2);
+			__m256i * row1 = (__m256i *) (out + (y*2+1) * outw + x*2);
+
+			if(clearRun(tiles, x*2, y*2))
+			{
+				_mm256_storeu_si256(row0, _mm256_setzero_si256());
+				_mm256_storeu_si256(row0 + 1, _mm256_setzero_si256());
+				_mm256_storeu_si256(row1, _mm256_setzero_si256());
+				_mm256_storeu_si256(row1 + 1, _mm256_setzero_si256());
+				continue;
 			}
 
-			float d_edge = diagonal_edge(Y, &wp[0]);
-			float r1, g1, b1, a1, r2, g2, b2, a2, rf, gf, bf, af;
-			bilinear_filter(w3, w4, r, g, b, a,  r1, g1, b1, a1, r2, g2, b2, a2);
-
-			// generate and write result
-			if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
-			else { rf = r2; gf = g2; bf = b2; af = a2; }
-
-			float min_r_sample = min4(r[1][1], r[2][1], r[1][2], r[2][2]);
-			float min_g_sample = min4(g[1][1], g[2][1], g[1][2], g[2][2]);
-			float min_b_sample = min4(b[1][1], b[2][1], b[1][2], b[2][2]);
-			float min_a_sample = min4(a[1][1], a[2][1], a[1][2], a[2][2]);
-			float max_r_sample = max4(r[1][1], r[2][1], r[1][2], r[2][2]);
-			float max_g_sample = max4(g[1][1], g[2][1], g[1][2], g[2][2]);
-			float max_b_sample = max4(b[1][1], b[2][1], b[1][2], b[2][2]);
-			float max_a_sample = max4(a[1][1], a[2][1], a[1][2], a[2][2]);
-			out[y*outw + x+1] = toColor(min_r_sample, max_r_sample, rf, min_g_sample, max_g_sample, gf, min_b_sample, max_b_sample, bf, min_a_sample, max_a_sample, af);
-
-			for (int sx = -1; sx <= 2; ++sx) {
-				for (int sy = -1; sy <= 2; ++sy) {
-					// clamp pixel locations
-					int csy = clamp(sx - sy + 1 + y, 0, f*h - 1);
-					int csx = clamp(sx + sy - 1 + x, 0, f*w - 1);
-					// sample & add weighted components
-					uint32_t sample = out[csy*outw + csx];
-					r[sx + 1][sy + 1] = R(sample);
-					g[sx + 1][sy + 1] = G(sample);
-					b[sx + 1][sy + 1] = B(sample);
-					a[sx + 1][sy + 1] = A(sample);
-					Y[sx + 1][sy + 1] = getLuminescence(r[sx + 1][sy + 1], g[sx + 1][sy + 1], b[sx + 1][sy + 1]);
-				}
+			const T * p = planes.source + (y + 1) * pw + x + 1;
+			typename xbr_vector<T>::type f[4], lo[4], hi[4];
+			filter8<false>(p, win, xbr_weights<T>::w1, xbr_weights<T>::w2, f);
+			bounds8(p, win, lo, hi);
+			__m256i diagonal = toColor8(f, lo, hi);
+
+			__m256i c = _mm256_loadu_si256((const __m256i *) (data + y * w + x));
+			__m256i a, b;
+			interleave8(c, c, a, b);
+			_mm256_storeu_si256(row0, a);
+			_mm256_storeu_si256(row0 + 1, b);
+			interleave8(c, diagonal, a, b);
+			_mm256_storeu_si256(row1, a);
+			_mm256_storeu_si256(row1 + 1, b);
+		}
+
+		for(; x < w; ++x)
+		{
+			if(clearTile<2>(tiles, x*2, y*2))
+			{
+				out[(y*2)*outw + x*2] = out[(y*2)*outw + x*2+1] = out[(y*2+1)*outw + x*2] = out[(y*2+1)*outw + x*2+1] = 0;
+				continue;
+			}
+			firstPass<2, T>(data, out, w, h, x*2, y*2);
+		}
+	}
+}
+
+//the cells of rows [begin, end) away from the edges. their windows are diamonds: the samples with
+//even offsets are source pixels, the odd ones are diagonals.
+template<class T>
+static
+void TARGET("avx2") secondPassAvx2(uint32_t * out, int w, int h, const tile_map & tiles, const xbr_planes<T> & planes, int begin, int end)
+{
+	const int outw = w*2;
+	const int pw = planes.stride;
+	const ptrdiff_t diagonals = planes.diagonals - planes.source;
+
+	auto diamond = [pw, diagonals](int d, int e) -> ptrdiff_t
+	{
+		return (d & 1)? diagonals + (d - 1) / 2 + (e - 1) / 2 * pw : d / 2 + e / 2 * pw;
+	};
+
+	xbr_window win1, win2;
+	win1.plane = win2.plane = planes.plane;
+
+	for(int sx = -1; sx <= 2; ++sx)
+	{
+		for(int sy = -1; sy <= 2; ++sy)
+		{
+			win1.offset[sx + 1][sy + 1] = diamond(sx + sy, sx - sy);
+			win2.offset[sx + 1][sy + 1] = diamond(sx + sy - 1, sx - sy + 1);
+		}
+	}
+
+	const __m256i even = _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+	const __m256i odd  = _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+
+	for(int y = std::max(begin, 2); y < std::min(end, h - 2); ++y)
+	{
+		int x = 2;
+		for(; x + 8 <= w - 2; x += 8)
+		{
+			if(clearRun(tiles, x*2, y*2))
+			{
+				continue;
 			}
-			d_edge = diagonal_edge(Y, &wp[0]);
-			bilinear_filter(w3, w4, r, g, b, a,  r1, g1, b1, a1, r2, g2, b2, a2);
-			// generate and write result
-			if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
-			else { rf = r2; gf = g2; bf = b2; af = a2; }
 
-			out[(y+1)*outw + x] = toColor(min_r_sample, max_r_sample, rf, min_g_sample, max_g_sample, gf, min_b_sample, max_b_sample, bf, min_a_sample, max_a_sample, af);
+			const T * p = planes.source + (y + 1) * pw + x + 1;
+			typename xbr_vector<T>::type f[4], lo[4], hi[4];
+			filter8<true>(p, win1, xbr_weights<T>::w3, xbr_weights<T>::w4, f);
+			bounds8(p, win1, lo, hi);
+			__m256i right = toColor8(f, lo, hi);
+			filter8<true>(p, win2, xbr_weights<T>::w3, xbr_weights<T>::w4, f);
+			__m256i below = toColor8(f, lo, hi);
+
+//only the new pixels are written, the others are being read by the neighboring bands
+			int * row0 = (int *) (out + (y*2) * outw + x*2);
+			int * row1 = (int *) (out + (y*2+1) * outw + x*2);
+			__m256i a, b;
+			interleave8(right, right, a, b);
+			_mm256_maskstore_epi32(row0, odd, a);
+			_mm256_maskstore_epi32(row0 + 8, odd, b);
+			interleave8(below, below, a, b);
+			_mm256_maskstore_epi32(row1, even, a);
+			_mm256_maskstore_epi32(row1 + 8, even, b);
+		}
+
+		for(; x < w - 2; ++x)
+		{
+			if(!clearTile<2>(tiles, x*2, y*2))
+			{
+				secondPass<2, T>(out, w, h, x*2, y*2);
+			}
 		}
 	}
+}
+
+//one block of the third pass. pixel (x, y) never needs anything from the others on its line x + 3y,
+//so those go 8 at a time. the block's lines are worked through from the bottom right, 16 of them kept
+//in planes at once along with the rows above and below that the windows reach.
+template<class T>
+static
+void TARGET("avx2") thirdPassAvx2(uint32_t * out, int w, int h, const tile_map & tiles, const xbr_block & block)
+{
+	enum { LINES = 16 };
+	const int outw = w*2, outh = h*2;
+	const int last = (outw - 1) + 3 * (outh - 1);
+	const int top = std::max(0, block.begin - 2);
+	const int bottom = std::min(outh, block.end + 1);
+	const ptrdiff_t lp = bottom - top;
+
+	uint8_t * scratch = (uint8_t *) borrowScratch(ARENA_DIAGONALS, lp * LINES * (sizeof(uint32_t) + sizeof(T) * XBR_PLANES));
+	uint32_t * line_colors = (uint32_t *) scratch;
+	T * line_planes = (T *) (scratch + lp * LINES * sizeof(uint32_t));
+
+//the rows above are only read on lines up to the block's first, the row below from its last on.
+//past those they can belong to the blocks running alongside this one.
+	auto load = [&](int k)
+	{
+		uint32_t * colors = line_colors + (k & (LINES-1)) * lp - top;
+		T * p = line_planes + (k & (LINES-1)) * lp * XBR_PLANES - top;
+		int first, end;
+		lineRows(k, outw, outh, k <= block.first? top : block.begin, k >= block.last? bottom : block.end, first, end);
+		for(int y = first; y <= end; ++y)
+		{
+			colors[y] = out[y * outw + k - 3*y];
+			splitPixel(colors[y], p + y, lp);
+		}
+	};
+
+//only the block's own pixels go back
+	auto store = [&](int k)
+	{
+		const uint32_t * colors = line_colors + (k & (LINES-1)) * lp - top;
+		int first, end;
+		lineRows(k, outw, outh, block.begin, block.end, first, end);
+		for(int y = first; y <= end; ++y)
+		{
+			out[y * outw + k - 3*y] = colors[y];
+		}
+	};
+
+	auto sample = [line_colors, lp, top](int x, int y) { return line_colors[((x + 3*y) & (LINES-1)) * lp + y - top]; };
+
+	xbr_window win;
+	win.plane = lp;
 
-	// Third Pass
-	wp[0] =  2.0f;
-	wp[1] =  1.0f;
-	wp[2] = -1.0f;
-	wp[3] =  4.0f;
-	wp[4] = -1.0f;
-	wp[5] =  1.0f;
-
-	for (int y = outh - 1; y >= 0; --y) {
-		for (int x = outw - 1; x >= 0; --x) {
-			float r[4][4], g[4][4], b[4][4], a[4][4], Y[4][4];
-			for (int sx = -2; sx <= 1; ++sx) {
-				for (int sy = -2; sy <= 1; ++sy) {
-					// clamp pixel locations
-					int csy = clamp(sy + y, 0, f*h - 1);
-					int csx = clamp(sx + x, 0, f*w - 1);
-					// sample & add weighted components
-					uint32_t sample = out[csy*outw + csx];
-					r[sx + 2][sy + 2] = R(sample);
-					g[sx + 2][sy + 2] = G(sample);
-					b[sx + 2][sy + 2] = B(sample);
-					a[sx + 2][sy + 2] = A(sample);
-					Y[sx + 2][sy + 2] = getLuminescence(r[sx + 2][sy + 2], g[sx + 2][sy + 2], b[sx + 2][sy + 2]);
+//the windows reach lines k-8 to k+4
+	const int highest = std::min(last, block.first + 4);
+	int loaded = highest + 1;
+
+	for(int k = block.first; k >= block.last; --k)
+	{
+		for(; loaded > std::max(0, k - 8); )
+		{
+			--loaded;
+			if(loaded + LINES <= block.first)
+			{
+				store(loaded + LINES);
+			}
+			load(loaded);
+		}
+
+		for(int sx = 0; sx < 4; ++sx)
+		{
+			for(int sy = 0; sy < 4; ++sy)
+			{
+				win.offset[sx][sy] = ((k + (sx - 2) + 3 * (sy - 2)) & (LINES-1)) * lp * XBR_PLANES + (sy - 2) - top;
+			}
+		}
+
+		uint32_t * colors = line_colors + (k & (LINES-1)) * lp - top;
+		T * planes = line_planes + (k & (LINES-1)) * lp * XBR_PLANES - top;
+
+//the pixels whose windows don't need clamping
+		const int inside_first = std::max(2, -floorDiv3(outw - 2 - k));
+		const int inside_last  = std::min(outh - 2, floorDiv3(k - 2));
+
+		int y, end;
+		lineRows(k, outw, outh, block.begin, block.end, y, end);
+
+		while(y <= end)
+		{
+			if(y >= inside_first && y + 7 <= inside_last && y + 7 <= end)
+			{
+				bool clear = true;
+				for(int i = 0; i < 8 && clear; ++i)
+				{
+					clear = clearTile<2>(tiles, k - 3 * (y + i), y + i);
 				}
+
+				if(!clear)
+				{
+					const T * p = line_planes + y;
+					typename xbr_vector<T>::type f[4], lo[4], hi[4];
+					filter8<false>(p, win, xbr_weights<T>::w3, xbr_weights<T>::w4, f);
+					bounds8(p, win, lo, hi);
+					_mm256_storeu_si256((__m256i *) (colors + y), toColor8(f, lo, hi));
+
+					for(int c = XBR_R; c <= XBR_A; ++c)
+					{
+						store8(planes + c * lp + y, f[c]);
+					}
+					store8(planes + XBR_Y * lp + y, luminance8(f));
+				}
+
+				y += 8;
+				continue;
 			}
-			float d_edge = diagonal_edge(Y, &wp[0]);
-			float r1, g1, b1, a1, r2, g2, b2, a2, rf, gf, bf, af;
-			bilinear_filter(w3, w4, r, g, b, a,  r1, g1, b1, a1, r2, g2, b2, a2);
 
-			// generate and write result
-			if (d_edge <= 0.0f) { rf = r1; gf = g1; bf = b1; af = a1; }
-			else { rf = r2; gf = g2; bf = b2; af = a2; }
+			int x = k - 3*y;
+			if(!clearTile<2>(tiles, x, y))
+			{
+				colors[y] = thirdPass<2, T>(sample, w, h, x, y);
+				splitPixel(colors[y], planes + y, lp);
+			}
 
-			out[y*outw + x] = toColor(r, rf, g, gf, b, bf, a, af);
+			++y;
 		}
 	}
 
+	for(int k = std::max(block.last, loaded); k <= std::min(block.first, loaded + LINES - 1); ++k)
+	{
+		store(k);
+	}
 }
 
-//// *** Super-xBR code ends here - MIT LICENSE *** ///
+template<class T>
+static
+void scaleSuperXbrAvx2(const uint32_t * data, uint32_t * out, int w, int h, const tile_map & tiles)
+{
+	xbr_planes<T> planes;
+	planes.stride = w + 3;
+	planes.plane = (ptrdiff_t) planes.stride * (h + 3);
+	planes.source = borrowScratch<T>(ARENA_PLANES, planes.plane * XBR_PLANES * 2);
+	planes.diagonals = planes.source + planes.plane * XBR_PLANES;
+
+	forEachBand(h + 3, [data, w, h, &planes](int begin, int end)
+	{
+		for(int y = begin - 1; y < end - 1; ++y)
+		{
+			const uint32_t * src = data + clamp(y, 0, h - 1) * w;
+			for(int x = -1; x < w + 2; ++x)
+			{
+				splitPixel(src[clamp(x, 0, w - 1)], planes.source + (y + 1) * planes.stride + x + 1, planes.plane);
+			}
+		}
+		return 0;
+	}, 32);
+
+	forEachBand(h, [=, &tiles, &planes](int begin, int end)
+	{
+		firstPassAvx2(data, out, w, h, tiles, planes, begin, end);
+
+		for(int y = begin; y < end; ++y)
+		{
+			for(int x = 0; x < w; ++x)
+			{
+				splitPixel(out[(y*2+1)*w*2 + x*2+1], planes.diagonals + (y + 1) * planes.stride + x + 1, planes.plane);
+			}
+		}
+		return 0;
+	}, 32);
+
+	forEachBand(h, [=, &tiles, &planes](int begin, int end)
+	{
+		secondPassAvx2(out, w, h, tiles, planes, begin, end);
+		return 0;
+	}, 32);
 
-void FLATTEN scaleSuperXbr(uint32_t *data, uint32_t *out, int w, int h)
+	secondPassEdges<2, T>(out, w, h, tiles);
+
+	forEachWave(w*2, h*2, [=, &tiles](const xbr_block & block)
+	{
+		thirdPassAvx2<T>(out, w, h, tiles, block);
+	});
+}
+
+#endif
+
+template<class T>
+static
+void FLATTEN scaleSuperXbrScalar(const uint32_t *data, uint32_t *out, int w, int h, const tile_map & tiles)
 {
-	scaleSuperXBRT<2>(data, out, w, h);
+	scaleSuperXBRT<2, T>(data, out, w, h, tiles);
 }
 
+template<class T>
+static
+void scaleSuperXbrSteps(const uint32_t * data, uint32_t * const out[], int steps, int w, int h, const tile_map & tiles)
+{
+	tile_map map = tiles;
+
+	for(int i = 0; i < steps; ++i, w *= 2, h *= 2)
+	{
+		const uint32_t * src = i? out[i-1] : data;
+
+		if(i)
+		{
+			map = buildTileMap((const uchar *) src, w * sizeof(uint32_t), w, h);
+		}
+
+#if HAVE_X86_SIMD
+		if(simdLevel() == SIMD_AVX2)
+		{
+			scaleSuperXbrAvx2<T>(src, out[i], w, h, map);
+			continue;
+		}
+#endif
+
+		scaleSuperXbrScalar<T>(src, out[i], w, h, map);
+	}
+}
+
+//steps doublings one after another, out[i] gets the result of the i-th. the tiles are only the source's,
+//the later steps map what the step before gave them. fixed does it in whole numbers, which come out
+//the same whatever the compiler or the instruction set but aren't quite the float shader's.
+void scaleSuperXbr(const uint32_t * data, uint32_t * const out[], int steps, int w, int h, const tile_map & tiles, bool fixed)
+{
+	if(fixed)
+	{
+		scaleSuperXbrSteps<int16_t>(data, out, steps, w, h, tiles);
+	}
+	else
+	{
+		scaleSuperXbrSteps<float>(data, out, steps, w, h, tiles);
+	}
+}
+
+void scaleSuperXbr(const uint32_t *data, uint32_t *out, int w, int h, const tile_map & tiles)
+{
+	scaleSuperXbr(data, &out, 1, w, h, tiles, false);
+}
@@ -0,0 +1,241 @@
+#include "baseline.h"
+#include <cmath>
+#include <cstdint>
+
+static
+void getAdjacentAlpha(QRgb pixel[9], const QImage & original, int x, int y)
+{
+	for(int8_t i = 0; i < 9; ++i)
+	{
+		pixel[i] = original.pixel(x, y);
+	}
+
+	int8_t i = 0;
+	for(int8_t _x = -1; _x < 2; ++_x)
+	{
+		if(0 <= _x + x && _x + x < original.width())
+		{
+			i = (_x + 1)*3;
+
+			for(int8_t _y = -1; _y < 2; ++_y, ++i)
+			{
+				if(0 <= _y + y && _y + y < original.height())
+				{
+					pixel[i] = original.pixel(x + _x, y + _y);
+				}
+			}
+		}
+	}
+}
+
+static
+QRgb blurTransparentPixel(const QImage & original, int x, int y, bool force = false)
+{
+	QRgb c[9];
+	getAdjacentAlpha(c, original, x, y);
+
+	int red=0, green=0, blue=0, alpha=0;
+	int j = 0;
+
+	for(uint8_t i = 0; i < 9; ++i)
+	{
+		red	  += qRed(c[i])*qRed(c[i]);
+		green += qGreen(c[i])*qGreen(c[i]);
+		blue  += qBlue(c[i])*qBlue(c[i]);
+		c[i]   = qAlpha(c[i]);
+		alpha += c[i];
+
+		if(c[i])
+		{
+			++j;
+		}
+	}
+
+	if((force && j)
+	|| (c[1] && c[7]) || (c[3] && c[5])
+	||(((0 < c[1] && c[1] < 255)
+	||  (0 < c[7] && c[7] < 255))
+	&& ((0 < c[3] && c[3] < 255)
+	||  (0 < c[5] && c[5] < 255))))
+	{
+		return qRgba(
+			sqrt(red/j),
+			sqrt(green/j),
+			sqrt(blue/j),
+			alpha/9);
+	}
+
+	return original.pixel(x, y);
+}
+
+static
+void forceBlurTransparentPixel(const QImage & original, QImage & retn, const int x, const int y)
+{
+	if(x-1 >= 0 && x+1 <= original.width()
+	&& y-1 >= 0 && y+1 <= original.height())
+	{
+		retn.setPixel(x, y, blurTransparentPixel(original, x, y, true));
+	}
+}
+
+static
+QRgb blurSolidPixel(const QImage & original,  QImage & retn, const int x, const int y)
+{
+	QRgb c[9];
+	getAdjacentAlpha(c, original, x, y);
+
+	uint32_t j = 0;
+	for(uint8_t i = 0; i < 9; ++i)
+	{
+		c[i] = qAlpha(c[i]);
+		j += c[i];
+	}
+
+	if((!c[1] && !c[7]) || (!c[3] && !c[5]))
+	{
+//surrounded by transparency, must be in very loose dither...
+		if(j == c[4])
+		{
+			forceBlurTransparentPixel(original, retn, x-1, y-1);
+			forceBlurTransparentPixel(original, retn, x  , y-1);
+			forceBlurTransparentPixel(original, retn, x+1, y-1);
+			forceBlurTransparentPixel(original, retn, x-1, y  );
+
+			forceBlurTransparentPixel(original, retn, x+1, y  );
+			forceBlurTransparentPixel(original, retn, x-1, y+1);
+			forceBlurTransparentPixel(original, retn, x  , y+1);
+			forceBlurTransparentPixel(original, retn, x+1, y+1);
+		}
+
+		return j / 16;
+	}
+
+	return c[4];
+}
+
+static
+int blurColorsPass(QImage & original)
+{
+	QImage retn(original);
+
+	int no_changed = 0;
+
+	for(int x = 0; x < original.width(); ++x)
+	{
+		for(int y = 0; y < original.height(); ++y)
+		{
+			QRgb c = original.pixel(x, y);
+
+			if(qAlpha(c) == 0)
+			{
+				auto t = blurTransparentPixel(original, x, y);
+				if(t != c)
+				{
+					retn.setPixel(x, y, t);
+					no_changed += 1;
+				}
+			}
+			else if(qAlpha(c) == 0xFF)
+			{
+				int t = blurSolidPixel(original, retn, x, y);
+				if(t != qAlpha(c))
+				{
+					retn.setPixel(x, y, (t << 24) | (c & 0x00FFFFFF));
+					no_changed += 1;
+				}
+			}
+		}
+	}
+
+	original = retn;
+	return no_changed;
+}
+
+QImage baselineBlurColors(const QImage & original, int blur_iterations)
+{
+	QImage retn(original);
+	for(int i = 0; i < blur_iterations; ++i)
+	{
+		if(blurColorsPass(retn) == 0)
+		{
+			break;
+		}
+	}
+	return retn;
+}
+
+static
+int blurAlphaPass(QImage & image)
+{
+	QImage retn(image);
+
+	int no_changed = 0;
+
+		int d[4];
+		for(int x = 0; x < image.width(); ++x)
+		{
+			d[3] = x     ==			    0? 0 : x-1;
+			d[2] = x + 1 == image.width()? 0 : x+1;
+
+			for(int y = 0; y < image.height(); ++y)
+			{
+				d[1] = y     ==			     0? 0 : y-1;
+				d[0] = y + 1 == image.height()? 0 : y+1;
+
+				int o = qAlpha(image.pixel(x, y));
+
+				if(o == 0)
+				{
+					continue;
+				}
+
+				QRgb c[9];
+				c[0] = qAlpha(image.pixel(d[3], d[1]));
+				c[1] = qAlpha(image.pixel(d[3], y  ));
+				c[2] = qAlpha(image.pixel(d[3], d[0]));
+				c[3] = qAlpha(image.pixel(x  , d[1]));
+				c[4] = qAlpha(image.pixel(x, y  ));
+				c[5] = qAlpha(image.pixel(x, d[0]));
+				c[6] = qAlpha(image.pixel(d[2], d[1]));
+				c[7] = qAlpha(image.pixel(d[2], y  ));
+				c[8] = qAlpha(image.pixel(d[2], d[0]));
+
+				int p = 0;
+				int j = 0;
+				for(int i = 0; i < 9; ++i)
+				{
+					if(0 < c[i])
+					{
+						p += c[i];
+						++j;
+					}
+				}
+
+				if(p && j)
+				{
+					p = p / j;
+					if(p != o)
+					{
+						retn.setPixel(x, y, (p << 24) | (image.pixel(x, y) & 0x00FFFFFF));
+						++no_changed;
+					}
+				}
+			}
+		}
+
+	image = retn;
+	return no_changed;
+}
+
+QImage baselineBlurAlpha(const QImage & original, int blur_iterations)
+{
+	QImage retn(original);
+	for(int i = 0; i < blur_iterations; ++i)
+	{
+		if(!blurAlphaPass(retn))
+		{
+			break;
+		}
+	}
+	return retn;
+}
@@ -0,0 +1,10 @@
+#ifndef BASELINE_H
+#define BASELINE_H
+#include <QImage>
+
+//the reverse dither filters as they were before any of the rewrites, pixel() and setPixel() and all.
+//they are kept here unchanged so the self test can hold the current filters to them exactly.
+QImage baselineBlurColors(const QImage & original, int blur_iterations);
+QImage baselineBlurAlpha(const QImage & original, int blur_iterations);
+
+#endif // BASELINE_H
@@ -0,0 +1,73 @@
+#include "selftest.h"
+#include "simd.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QProcess>
+#include <QThreadPool>
+#include <cstdio>
+
+static const char * SIMD_NAMES[] = { "scalar", "sse2", "avx2" };
+
+//every kernel has to give the same output at every level, so a run that wasn't asked for a level
+//runs itself again at each one below what the machine has
+static
+int runLowerLevels()
+{
+	QStringList arguments = QCoreApplication::arguments().mid(1);
+	arguments.removeAll("--record");
+
+	int failed = 0;
+
+	for(int level = SIMD_SCALAR; level < simdLevel(); ++level)
+	{
+		QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+		environment.insert("SPRITEBUILDER_SIMD", SIMD_NAMES[level]);
+
+		QProcess process;
+		process.setProcessEnvironment(environment);
+		process.setProcessChannelMode(QProcess::ForwardedChannels);
+		process.start(QCoreApplication::applicationFilePath(), arguments);
+
+		if(!process.waitForFinished(-1)
+		|| process.exitStatus() != QProcess::NormalExit
+		|| process.exitCode() != 0)
+		{
+			fprintf(stderr, "The %s kernels failed.\n", SIMD_NAMES[level]);
+			++failed;
+		}
+	}
+
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Checks the import kernels on a built in corpus and times them.");
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption("golden", "Compare the output digests with <file> (default: tests/golden.txt).", "file", SELFTEST_DIR "/golden.txt"));
+	parser.addOption(QCommandLineOption("references", "Compare the scaled frames with the images in <dir> (default: tests/reference).", "dir", SELFTEST_DIR "/reference"));
+	parser.addOption(QCommandLineOption("record", "Write the digests and reference images instead, when a kernel's output is meant to change."));
+	parser.addOption(QCommandLineOption("repeat", "Runs to take the best time of (default 3).", "n", "3"));
+	parser.addOption(QCommandLineOption(QStringList() << "j" << "jobs", "Use <n> threads (default: all cores).", "n"));
+	parser.process(a);
+
+	if(parser.isSet("jobs"))
+	{
+		QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value("jobs").toInt()));
+	}
+
+	printf("simd level: %s\n", SIMD_NAMES[simdLevel()]);
+
+	int failed = runSelfTest(parser.value("golden"), parser.value("references"), qMax(1, parser.value("repeat").toInt()), parser.isSet("record"));
+
+	if(qEnvironmentVariableIsEmpty("SPRITEBUILDER_SIMD"))
+	{
+		fflush(stdout);
+		failed += runLowerLevels();
+	}
+
+	return failed? 1 : 0;
+}
@@ -0,0 +1,988 @@
+#include "selftest.h"
+#include "baseline.h"
+#include "reversedither.h"
+#include "spritedecoder.h"
+#include "spriteencoder.h"
+#include "imageview.h"
+#include "pixelconvert.h"
+#include "pallet_dta.h"
+#include "byteswap.h"
+#include "importpipeline.h"
+#include "importsettings.h"
+#include <squish.h>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QFile>
+#include <QMap>
+#include <QStringList>
+#include <QCommandLineParser>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+
+QRect calculateBoundingBox(const QImage & img);
+QImage scale_image(QImage image, int factor, bool fixed);
+
+//the corpus is made up here so it's the same on every machine, sizes are multiples of 4 like imported frames
+static const int CORPUS_SIZES[][2] = { {4, 4}, {8, 12}, {36, 20}, {64, 64}, {128, 92}, {320, 240} };
+static const int CORPUS_FRAMES = sizeof(CORPUS_SIZES) / sizeof(CORPUS_SIZES[0]);
+
+struct xorshift
+{
+	uint32_t state;
+
+	uint32_t operator()()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+};
+
+//a blob with a solid middle and a loosely dithered rim, noisy colors, alpha only 0 or 255 like a decoded sprite
+static
+QImage syntheticFrame(int w, int h, uint32_t seed)
+{
+	QImage image(w, h, QImage::Format_ARGB32);
+	xorshift rng{ seed * 2654435761u + 1 };
+
+	for(int y = 0; y < h; ++y)
+	{
+		QRgb * line = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+		for(int x = 0; x < w; ++x)
+		{
+			double dx = (x + .5) / w * 2 - 1;
+			double dy = (y + .5) / h * 2 - 1;
+			double d  = dx*dx + dy*dy;
+
+			uint32_t noise = rng();
+			bool solid = d < .4 || (d < .8 && ((x + y) & 1) && (noise & 0x300)) || (d < 1 && !(noise & 0x700));
+			line[x] = (solid? 0xFF000000 : 0) | (noise & 0x00FFFFFF);
+		}
+	}
+
+	return image;
+}
+
+static
+std::vector<QImage> syntheticCorpus()
+{
+	std::vector<QImage> corpus;
+
+	for(int i = 0; i < CORPUS_FRAMES; ++i)
+	{
+		corpus.push_back(syntheticFrame(CORPUS_SIZES[i][0], CORPUS_SIZES[i][1], i));
+	}
+
+	return corpus;
+}
+
+//small frames for the filters' corner cases: solid pixels alone in a corner and in the middle, partial alpha
+//all around the rim where blur_alpha's neighbors wrap to the first row and column, and sizes that are no
+//multiple of the 8x8 tiles or of a vector
+static const int EDGE_SIZES[][2] = { {1, 1}, {1, 9}, {9, 1}, {2, 3}, {5, 5}, {7, 13}, {17, 6}, {23, 19} };
+static const int EDGE_FRAMES = sizeof(EDGE_SIZES) / sizeof(EDGE_SIZES[0]);
+
+static
+QImage edgeFrame(int w, int h, uint32_t seed)
+{
+	QImage image(w, h, QImage::Format_ARGB32);
+	xorshift rng{ seed * 2654435761u + 7 };
+
+	for(int y = 0; y < h; ++y)
+	{
+		QRgb * line = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+		for(int x = 0; x < w; ++x)
+		{
+			uint32_t noise = rng();
+			uint32_t alpha = 0;
+
+			if(x == 0 || y == 0 || x == w-1 || y == h-1)
+			{
+				alpha = (noise & 0x01000000)? noise >> 24 : 0;
+			}
+			else if(((x + y) & 1) && (noise & 0x300))
+			{
+				alpha = 0xFF;
+			}
+
+			line[x] = (alpha << 24) | (noise & 0x00FFFFFF);
+		}
+	}
+
+	const int alone[][2] = { {0, 0}, {w-1, 0}, {0, h-1}, {w-1, h-1}, {w/2, h/2} };
+
+	for(auto & p : alone)
+	{
+		for(int y = std::max(p[1]-1, 0); y <= std::min(p[1]+1, h-1); ++y)
+		{
+			for(int x = std::max(p[0]-1, 0); x <= std::min(p[0]+1, w-1); ++x)
+			{
+				image.setPixel(x, y, image.pixel(x, y) & 0x00FFFFFF);
+			}
+		}
+
+		image.setPixel(p[0], p[1], 0xFF000000 | (rng() & 0x00FFFFFF));
+	}
+
+	return image;
+}
+
+static
+std::vector<QImage> edgeCorpus()
+{
+	std::vector<QImage> corpus;
+
+	for(int i = 0; i < EDGE_FRAMES; ++i)
+	{
+		corpus.push_back(edgeFrame(EDGE_SIZES[i][0], EDGE_SIZES[i][1], i));
+	}
+
+	return corpus;
+}
+
+//the frames side by side along the top of one image, so a filter's output over a corpus is one reference
+static
+QImage sheet(const std::vector<QImage> & frames)
+{
+	int w = 0, h = 0;
+
+	for(auto & frame : frames)
+	{
+		w += frame.width();
+		h  = std::max(h, frame.height());
+	}
+
+	QImage image(w, h, QImage::Format_ARGB32);
+	image.fill(0);
+
+	int left = 0;
+
+	for(auto & frame : frames)
+	{
+		for(int y = 0; y < frame.height(); ++y)
+		{
+			memcpy(reinterpret_cast<QRgb*>(image.scanLine(y)) + left, frame.constScanLine(y), frame.width() * sizeof(QRgb));
+		}
+
+		left += frame.width();
+	}
+
+	return image;
+}
+
+//fnv-1a over the pixels and size of the images
+struct pixel_digest
+{
+	uint64_t value = 0xcbf29ce484222325ull;
+
+	void add(const void * data, size_t bytes)
+	{
+		const uchar * p = reinterpret_cast<const uchar*>(data);
+
+		for(size_t i = 0; i < bytes; ++i)
+		{
+			value = (value ^ p[i]) * 0x100000001b3ull;
+		}
+	}
+
+	void add(int v)
+	{
+		add(&v, sizeof(v));
+	}
+
+	void add(const QImage & image)
+	{
+		add(image.width());
+		add(image.height());
+
+		for(int y = 0; y < image.height(); ++y)
+		{
+			add(image.constScanLine(y), image.width() * sizeof(QRgb));
+		}
+	}
+};
+
+//what a kernel did: whether it matched its reference, the digest of its output and its best time
+struct kernel_result
+{
+	const char * name;
+	int failures;
+	uint64_t digest;
+	double seconds;
+};
+
+template<typename F>
+static
+double bestOf(int repeat, F f)
+{
+	double best = 0;
+
+	for(int i = 0; i < repeat; ++i)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		f();
+		double t = timer.nsecsElapsed() / 1e9;
+		best = (i == 0 || t < best)? t : best;
+	}
+
+	return best;
+}
+
+static
+int countDifferences(const QImage & a, const QImage & b)
+{
+	if(a.size() != b.size())
+	{
+		return 1;
+	}
+
+	int n = 0;
+
+	for(int y = 0; y < a.height(); ++y)
+	{
+		const QRgb * p = reinterpret_cast<const QRgb*>(a.constScanLine(y));
+		const QRgb * q = reinterpret_cast<const QRgb*>(b.constScanLine(y));
+
+		for(int x = 0; x < a.width(); ++x)
+		{
+			n += p[x] != q[x];
+		}
+	}
+
+	return n;
+}
+
+static
+QImage blankFrame(int w, int h)
+{
+	QImage image(w, h, QImage::Format_ARGB32);
+	image.fill(0);
+	return image;
+}
+
+static
+kernel_result testFrom565(int repeat)
+{
+	kernel_result r{ "from565", 0, 0, 0 };
+
+	std::vector<uchar> words(0x10000 * 2);
+	std::vector<QRgb> plain(0x10000), keyed(0x10000);
+
+	for(int c = 0; c < 0x10000; ++c)
+	{
+		words[c*2]   = c & 0xFF;
+		words[c*2+1] = c >> 8;
+	}
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		convertSpan(words.data(), plain.data(), 0x10000, true);
+		convertSpan(words.data(), keyed.data(), 0x10000, true, true);
+	});
+
+	for(int c = 0; c < 0x10000; ++c)
+	{
+		r.failures += plain[c] != from565(c);
+		r.failures += keyed[c] != (c? from565(c) : 0);
+	}
+
+	pixel_digest d;
+	d.add(plain.data(), plain.size() * sizeof(QRgb));
+	d.add(keyed.data(), keyed.size() * sizeof(QRgb));
+	r.digest = d.value;
+	return r;
+}
+
+//what the decoder should make of a pixel the encoder was given
+static
+QRgb expectedC16(QRgb c, bool c16, bool _565)
+{
+	if(qAlpha(c) < 128)
+	{
+		return 0;
+	}
+
+	uint16_t w = _565
+		? ((qRed(c) >> 3) << 11) | ((qGreen(c) >> 2) << 5) | (qBlue(c) >> 3)
+		: ((qRed(c) >> 3) << 10) | ((qGreen(c) >> 3) << 5) | (qBlue(c) >> 3);
+
+	if(!c16 && !w)
+	{
+		w = 1;
+	}
+
+	if(_565)
+	{
+		return from565(w);
+	}
+
+	return 0xFF000000 | (w & 0x7C00) << 9 | (w & 0x03E0) << 6 | (w & 0x001F) << 3;
+}
+
+static
+kernel_result testDecoder(const char * name, SpriteDecoder & decoder, const QString & filename, std::function<QRgb(int, int, int)> expected, int repeat)
+{
+	kernel_result r{ name, 0, 0, 0 };
+
+	if(decoder.open(filename) != SpriteDecoder::Okay || decoder.frameCount() != CORPUS_FRAMES)
+	{
+		r.failures = 1;
+		return r;
+	}
+
+	std::vector<QImage> frames;
+
+	for(int i = 0; i < decoder.frameCount(); ++i)
+	{
+		frames.push_back(blankFrame(decoder.frameSize(i).width(), decoder.frameSize(i).height()));
+	}
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		for(int i = 0; i < decoder.frameCount(); ++i)
+		{
+			r.failures += !decoder.decodeFrame(i, frames[i]);
+		}
+	});
+
+	pixel_digest d;
+
+	for(int i = 0; i < (int) frames.size(); ++i)
+	{
+		for(int y = 0; y < frames[i].height(); ++y)
+		{
+			for(int x = 0; x < frames[i].width(); ++x)
+			{
+				r.failures += frames[i].pixel(x, y) != expected(i, x, y);
+			}
+		}
+
+		d.add(frames[i]);
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+static
+kernel_result testC16(const char * name, const std::vector<QImage> & corpus, const QString & filename, bool c16, bool _565, int repeat)
+{
+	if(!writeC16File(filename, corpus, c16, _565))
+	{
+		return kernel_result{ name, 1, 0, 0 };
+	}
+
+	C16Decoder decoder;
+	return testDecoder(name, decoder, filename, [&corpus, c16, _565](int i, int x, int y)
+	{
+		return expectedC16(corpus[i].pixel(x, y), c16, _565);
+	}, repeat);
+}
+
+//the low byte of each pixel's noise as its palette index
+static
+bool writeSprFile(const QString & filename, const std::vector<QImage> & frames)
+{
+	std::vector<uchar> out(2 + frames.size() * 8);
+	uint16_t count = byte_swap((uint16_t) frames.size());
+	memcpy(out.data(), &count, 2);
+
+	for(size_t i = 0; i < frames.size(); ++i)
+	{
+		uint32_t offset = byte_swap((uint32_t) out.size());
+		uint16_t w = byte_swap((uint16_t) frames[i].width());
+		uint16_t h = byte_swap((uint16_t) frames[i].height());
+		memcpy(out.data() + 2 + i*8,     &offset, 4);
+		memcpy(out.data() + 2 + i*8 + 4, &w, 2);
+		memcpy(out.data() + 2 + i*8 + 6, &h, 2);
+
+		for(int y = 0; y < frames[i].height(); ++y)
+		{
+			for(int x = 0; x < frames[i].width(); ++x)
+			{
+				out.push_back(qBlue(frames[i].pixel(x, y)));
+			}
+		}
+	}
+
+	QFile file(filename);
+
+	return file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+		&& file.write((const char *) out.data(), out.size()) == (qint64) out.size();
+}
+
+static
+kernel_result testSpr(const std::vector<QImage> & corpus, const QString & filename, int repeat)
+{
+	if(!writeSprFile(filename, corpus))
+	{
+		return kernel_result{ "spr decode", 1, 0, 0 };
+	}
+
+	SprDecoder decoder;
+	return testDecoder("spr decode", decoder, filename, [&corpus](int i, int x, int y)
+	{
+		return PALETTE_ARGB.color[qBlue(corpus[i].pixel(x, y))];
+	}, repeat);
+}
+
+//the rows a creatures 1 head of two 13 frame sets lands in with the import's default options, -1 is an
+//empty row. the rest of each set's first 8 frames are rotations that aren't imported, 1 and 14 are
+//mirrored by the symmetry option and 22 blinks backwards.
+static const int C1_HEAD_ROWS[32] =
+{
+	 9,  8,  5, -1, -1, 21, 18, -1, -1, 10, -1, -1, -1, 23, -1, -1,
+	-1, 11, -1, -1, -1, 24, -1, -1, -1, 12, -1, -1, -1, 25, -1, -1
+};
+
+//every frame gets its own height so a row can only have come from the frame it names
+static
+kernel_result testC1Heads(const QString & filename, int repeat)
+{
+	kernel_result r{ "spr c1 head rows", 0, 0, 0 };
+	std::vector<QImage> frames;
+
+	for(int i = 0; i < 26; ++i)
+	{
+		frames.push_back(syntheticFrame(4, 4 + i, i));
+	}
+
+	if(!writeSprFile(filename, frames))
+	{
+		r.failures = 1;
+		return r;
+	}
+
+	QCommandLineParser parser;
+	import_settings::addOptions(parser);
+	parser.parse(QStringList() << "selftest");
+	const import_settings settings(parser);
+
+	const sprite_format * format;
+	SpriteDecoder::Status status;
+	QSharedPointer<SpriteDecoder> decoder = openSprite(filename, &format, &status);
+
+	if(!decoder)
+	{
+		r.failures = 1;
+		return r;
+	}
+
+	std::vector<import_job> jobs;
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		planImport(decoder, *format, filename, settings, jobs);
+	});
+
+	r.failures += jobs.size() != 32;
+
+	pixel_digest d;
+
+	for(size_t i = 0; i < jobs.size(); ++i)
+	{
+		const int expected = i < 32? C1_HEAD_ROWS[i] : -1;
+
+		r.failures += jobs[i].frame != expected;
+		r.failures += expected >= 0 && jobs[i].height != 4 + expected;
+		d.add(jobs[i].frame);
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+//the N pass filters against the copies of the original ones in baseline.cpp
+static
+kernel_result testBlur(const char * name, QImage (*passes)(const QImage &, int), QImage (*baseline)(const QImage &, int),
+	int iterations, const std::vector<QImage> & corpus, int repeat)
+{
+	kernel_result r{ name, 0, 0, 0 };
+	std::vector<QImage> out(corpus.size());
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		for(size_t i = 0; i < corpus.size(); ++i)
+		{
+			out[i] = passes(corpus[i], iterations);
+		}
+	});
+
+	pixel_digest d;
+
+	for(size_t i = 0; i < corpus.size(); ++i)
+	{
+		r.failures += countDifferences(baseline(corpus[i], iterations), out[i]);
+		d.add(out[i]);
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+static
+kernel_result testReverseDither(const std::vector<QImage> & corpus, int repeat)
+{
+	kernel_result r{ "reverse dither", 0, 0, 0 };
+	std::vector<QImage> out(corpus.size());
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		for(size_t i = 0; i < corpus.size(); ++i)
+		{
+			out[i] = corpus[i].copy();
+			reverseDither(out[i], 4, 3);
+		}
+	});
+
+	pixel_digest d;
+
+	for(size_t i = 0; i < corpus.size(); ++i)
+	{
+		QImage fused = corpus[i].copy();
+		reverseDitherFused(fused, 4, 3);
+
+		r.failures += countDifferences(baselineBlurAlpha(baselineBlurColors(corpus[i], 4), 3), out[i]);
+		r.failures += countDifferences(fused, out[i]);
+		d.add(out[i]);
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+//a reference sheet and one of the current filters that has to reproduce it
+struct edge_filter
+{
+	const char * sheet;
+	std::function<QImage (const QImage &)> filter;
+};
+
+//the filters over the edge frames against the sheets the original filters made of them, which are
+//written instead when recording. the plain and fused reverse dither share theirs.
+static
+kernel_result testEdgeFrames(const QString & references, bool record, int repeat)
+{
+	kernel_result r{ "reverse dither edges", 0, 0, 0 };
+
+	const std::vector<QImage> corpus = edgeCorpus();
+
+	const edge_filter filters[] =
+	{
+		{ "edges_blur_colors_4",  [](const QImage & image) { return blur_colors(image, 4); } },
+		{ "edges_blur_colors_15", [](const QImage & image) { return blur_colors(image, 15); } },
+		{ "edges_blur_alpha_3",   [](const QImage & image) { return blur_alpha(image, 3); } },
+		{ "edges_reverse_dither", [](const QImage & image) { QImage out = image.copy(); reverseDither(out, 4, 3); return out; } },
+		{ "edges_reverse_dither", [](const QImage & image) { QImage out = image.copy(); reverseDitherFused(out, 4, 3); return out; } },
+	};
+	const int no_filters = sizeof(filters) / sizeof(filters[0]);
+
+	std::vector<std::vector<QImage>> out(no_filters, std::vector<QImage>(corpus.size()));
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		for(int f = 0; f < no_filters; ++f)
+		{
+			for(size_t i = 0; i < corpus.size(); ++i)
+			{
+				out[f][i] = filters[f].filter(corpus[i]);
+			}
+		}
+	});
+
+	pixel_digest d;
+
+	for(int f = 0; f < no_filters; ++f)
+	{
+		const QImage result = sheet(out[f]);
+		const QString file = references + QString("/%1.png").arg(filters[f].sheet);
+
+		d.add(result);
+
+		if(record)
+		{
+			r.failures += !result.save(file);
+			continue;
+		}
+
+		QImage expected;
+
+		if(!expected.load(file))
+		{
+			fprintf(stderr, "Unable to read the reference image '%s'.\n", qPrintable(file));
+			++r.failures;
+			continue;
+		}
+
+		r.failures += countDifferences(result, expected.convertToFormat(QImage::Format_ARGB32)) != 0;
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+//the first few frames are compared a pixel at a time with the images the original scaler made of them,
+//the fixed point scaler has no original and is held to its first output. they're written out as the
+//references when recording. the larger frames would only make the repo heavier, the digest still covers them.
+static const int REFERENCE_FRAMES = 4;
+
+static
+kernel_result testDoubleImage(const char * name, const char * reference, bool fixed, const std::vector<QImage> & corpus,
+	const QString & references, bool record, int repeat)
+{
+	kernel_result r{ name, 0, 0, 0 };
+	std::vector<QImage> out(corpus.size());
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		for(size_t i = 0; i < corpus.size(); ++i)
+		{
+			out[i] = scale_image(corpus[i], 2, fixed);
+		}
+	});
+
+	pixel_digest d;
+
+	for(size_t i = 0; i < corpus.size(); ++i)
+	{
+		r.failures += out[i].size() != corpus[i].size() * 2;
+		d.add(out[i]);
+
+		if((int) i >= REFERENCE_FRAMES)
+		{
+			continue;
+		}
+
+		const QString file = references + QString("/%1_%2x%3.png").arg(reference).arg(corpus[i].width()).arg(corpus[i].height());
+
+		if(record)
+		{
+			r.failures += !out[i].save(file);
+			continue;
+		}
+
+		QImage expected;
+
+		if(!expected.load(file))
+		{
+			fprintf(stderr, "Unable to read the reference image '%s'.\n", qPrintable(file));
+			++r.failures;
+			continue;
+		}
+
+		r.failures += countDifferences(out[i], expected.convertToFormat(out[i].format())) != 0;
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+static
+kernel_result testBoundingBox(const std::vector<QImage> & corpus, int repeat)
+{
+	kernel_result r{ "calculateBoundingBox", 0, 0, 0 };
+	std::vector<QRect> out(corpus.size());
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		for(size_t i = 0; i < corpus.size(); ++i)
+		{
+			out[i] = calculateBoundingBox(corpus[i]);
+		}
+	});
+
+	pixel_digest d;
+
+	for(size_t i = 0; i < corpus.size(); ++i)
+	{
+		int min_x = corpus[i].width(), min_y = corpus[i].height(), max_x = 0, max_y = 0;
+
+		for(int y = 0; y < corpus[i].height(); ++y)
+		{
+			for(int x = 0; x < corpus[i].width(); ++x)
+			{
+				if(qAlpha(corpus[i].pixel(x, y)) > 64)
+				{
+					min_x = std::min(min_x, x);
+					max_x = std::max(max_x, x);
+					min_y = std::min(min_y, y);
+					max_y = std::max(max_y, y);
+				}
+			}
+		}
+
+		r.failures += out[i] != QRect(min_x, min_y, max_x - min_x, max_y - min_y);
+
+		d.add(out[i].x());
+		d.add(out[i].y());
+		d.add(out[i].width());
+		d.add(out[i].height());
+	}
+
+	r.digest = d.value;
+	return r;
+}
+
+//what squish itself makes of a frame when it's handed the same pixels and flags as writeImage,
+//type is the byte writeImage starts the frame with. transparent pixels go in as 0 and come
+//out of readImage as 0, so a decoded pixel with all its bytes 0 is expected as 0 too.
+static
+bool squishRoundTrip(const QImage & image, int type, QImage & expected)
+{
+	int flags;
+
+	switch(type)
+	{
+	case 1:
+		flags = squish::kDxt1;
+		break;
+	case 3:
+		flags = squish::kDxt3 | squish::kColourIterativeClusterFit | squish::kWeightColourByAlpha;
+		break;
+	case 5:
+		flags = squish::kDxt5 | squish::kColourIterativeClusterFit | squish::kWeightColourByAlpha;
+		break;
+	default:
+		return false;
+	}
+
+	const int w = image.width();
+	const int h = image.height();
+
+	std::vector<uchar> pixels(w * h * 4, 0);
+
+	for(int y = 0; y < h; ++y)
+	{
+		for(int x = 0; x < w; ++x)
+		{
+			QRgb c = image.pixel(x, y);
+
+			if(qAlpha(c))
+			{
+				uchar * p = &pixels[(y * w + x) * 4];
+				p[0] = qRed(c);
+				p[1] = qGreen(c);
+				p[2] = qBlue(c);
+				p[3] = qAlpha(c);
+			}
+		}
+	}
+
+	std::vector<uchar> blocks(squish::GetStorageRequirements(w, h, flags));
+	squish::CompressImage(pixels.data(), w, h, blocks.data(), flags);
+	squish::DecompressImage(pixels.data(), w, h, blocks.data(), flags);
+
+	expected = QImage(w, h, QImage::Format_ARGB32_Premultiplied);
+
+	for(int y = 0; y < h; ++y)
+	{
+		QRgb * line = (QRgb *) expected.scanLine(y);
+
+		for(int x = 0; x < w; ++x)
+		{
+			const uchar * p = &pixels[(y * w + x) * 4];
+			line[x] = (p[0] | p[1] | p[2] | p[3])? qRgba(p[0], p[1], p[2], p[3]) : 0;
+		}
+	}
+
+	return true;
+}
+
+//the runs writeImage leaves out have to decode to what squish's own blocks would have, so every
+//frame that comes back has to match squish's round trip of it exactly, and the reader has to
+//stop where the writer did. the digest covers the exact bytes and pixels.
+static
+kernel_result testC32(const std::vector<QImage> & corpus, int repeat)
+{
+	kernel_result r{ "writeImage/readImage", 0, 0, 0 };
+
+	std::vector<ImageView *> views;
+
+	for(size_t i = 0; i < corpus.size(); ++i)
+	{
+		views.push_back(new ImageView(i, BAKED_IMAGE_SLOT));
+		views.back()->setImage(corpus[i], false);
+	}
+
+	FILE * file = tmpfile();
+
+	if(!file)
+	{
+		qDeleteAll(views);
+		r.failures = 1;
+		return r;
+	}
+
+	std::vector<long> offsets(views.size());
+
+	r.seconds = bestOf(repeat, [&]()
+	{
+		rewind(file);
+
+		for(size_t i = 0; i < views.size(); ++i)
+		{
+			offsets[i] = ftell(file);
+			views[i]->writeImage(file);
+		}
+	});
+
+	long written = ftell(file);
+	std::vector<uchar> bytes(written);
+	rewind(file);
+	r.failures += fread(bytes.data(), 1, written, file) != (size_t) written;
+
+	pixel_digest d;
+	d.add(bytes.data(), bytes.size());
+
+	rewind(file);
+
+	for(size_t i = 0; i < corpus.size(); ++i)
+	{
+		ImageView read(i, BAKED_IMAGE_SLOT);
+		read.readImage(file, corpus[i].width(), corpus[i].height(), false);
+
+		QImage expected;
+
+		if(offsets[i] >= written || !squishRoundTrip(views[i]->image, bytes[offsets[i]], expected))
+		{
+			++r.failures;
+		}
+		else
+		{
+			r.failures += countDifferences(read.image, expected) != 0;
+		}
+
+		d.add(read.image);
+	}
+
+	r.failures += ftell(file) != written;
+
+	fclose(file);
+	qDeleteAll(views);
+
+	r.digest = d.value;
+	return r;
+}
+
+//name and hex digest a line, lines starting with # are comments and are kept for recording
+static
+bool readGolden(const QString & filename, QMap<QString, quint64> & golden, QStringList & comments)
+{
+	QFile file(filename);
+
+	if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return false;
+	}
+
+	QTextStream in(&file);
+
+	while(!in.atEnd())
+	{
+		QString line = in.readLine();
+		int split = line.lastIndexOf(' ');
+
+		if(line.startsWith('#'))
+		{
+			comments << line;
+		}
+		else if(split > 0)
+		{
+			golden.insert(line.left(split), line.mid(split + 1).toULongLong(0L, 16));
+		}
+	}
+
+	return true;
+}
+
+int runSelfTest(const QString & golden_file, const QString & references, int repeat, bool record)
+{
+	QTemporaryDir dir;
+
+	if(!dir.isValid())
+	{
+		fprintf(stderr, "Unable to create a temporary directory.\n");
+		return 1;
+	}
+
+	const std::vector<QImage> corpus = syntheticCorpus();
+
+	std::vector<kernel_result> results;
+	results.push_back(testFrom565(repeat));
+	results.push_back(testC16("c16 565 decode", corpus, dir.filePath("corpus565.c16"), true,  true,  repeat));
+	results.push_back(testC16("c16 555 decode", corpus, dir.filePath("corpus555.c16"), true,  false, repeat));
+	results.push_back(testC16("s16 565 decode", corpus, dir.filePath("corpus565.s16"), false, true,  repeat));
+	results.push_back(testSpr(corpus, dir.filePath("corpus.spr"), repeat));
+	results.push_back(testC1Heads(dir.filePath("a000.spr"), repeat));
+	results.push_back(testBlur("blur_colors", blur_colors, baselineBlurColors, 4, corpus, repeat));
+	results.push_back(testBlur("blur_alpha",  blur_alpha,  baselineBlurAlpha,  3, corpus, repeat));
+	results.push_back(testReverseDither(corpus, repeat));
+	results.push_back(testEdgeFrames(references, record, repeat));
+	results.push_back(testDoubleImage("double_image", "double_image", false, corpus, references, record, repeat));
+	results.push_back(testDoubleImage("double_image fixed", "double_image_fixed", true, corpus, references, record, repeat));
+	results.push_back(testBoundingBox(corpus, repeat));
+	results.push_back(testC32(corpus, repeat));
+
+	QMap<QString, quint64> golden;
+	QStringList comments;
+
+	if(!readGolden(golden_file, golden, comments) && !record)
+	{
+		fprintf(stderr, "Unable to read the golden digests '%s'.\n", qPrintable(golden_file));
+		return 1;
+	}
+
+	int failed = 0;
+
+	printf("%-24s %8s %12s %18s\n", "kernel", "result", "best ms", "digest");
+
+	for(auto & r : results)
+	{
+		const char * status = "ok";
+
+		if(r.failures)
+		{
+			status = "FAILED";
+		}
+		else if(!record)
+		{
+			status = !golden.contains(r.name)? "new" : golden[r.name] != r.digest? "CHANGED" : "ok";
+		}
+
+		failed += strcmp(status, "ok") && strcmp(status, "new");
+		printf("%-24s %8s %12.3f %18llx\n", r.name, status, r.seconds * 1e3, (unsigned long long) r.digest);
+	}
+
+	if(record)
+	{
+		QFile file(golden_file);
+
+		if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			fprintf(stderr, "Unable to write '%s'.\n", qPrintable(golden_file));
+			return failed + 1;
+		}
+
+		QTextStream out(&file);
+
+		for(auto & line : comments)
+		{
+			out << line << '\n';
+		}
+
+		for(auto & r : results)
+		{
+			out << r.name << ' ' << QString::number(r.digest, 16) << '\n';
+		}
+
+		printf("Recorded the digests in '%s'.\n", qPrintable(golden_file));
+	}
+
+	return failed;
+}
@@ -0,0 +1,12 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+#include <QString>
+
+//the selftest target (tests/tests.pro) runs the import kernels over a synthetic corpus without the GUI.
+//every kernel is checked against a plain version of itself where there is one and timed, and the digests of
+//their outputs are compared against the golden file, or written to it when recording. the scaler's output
+//is also compared with the reference images in references, or written there when recording.
+//returns the number of kernels that failed, a golden file that can't be read fails them all.
+int runSelfTest(const QString & golden, const QString & references, int repeat, bool record);
+
+#endif // SELFTEST_H
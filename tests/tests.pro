@@ -0,0 +1,54 @@
+#-------------------------------------------------
+#
+# The import kernels' self test and benchmark, without the GUI.
+# qmake && make check builds and runs it.
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = selftest
+CONFIG += console testcase
+CONFIG -= app_bundle
+INCLUDEPATH += .. /home/anyuser/Downloads/squish-1.11/
+LIBS += -L/home/anyuser/Downloads/squish-1.11/ -lsquish
+DEFINES += SELFTEST_DIR=\\\"$$PWD\\\"
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    selftest.cpp \
+    baseline.cpp \
+    ../imageview.cpp \
+    ../scaleimages.cpp \
+    ../super_xbr.cpp \
+    ../importsettings.cpp \
+    ../spritedecoder.cpp \
+    ../pixelconvert.cpp \
+    ../importpipeline.cpp \
+    ../spriteencoder.cpp \
+    ../reversedither.cpp \
+    ../linearlight.cpp \
+    ../framearena.cpp \
+    ../tilemap.cpp
+
+HEADERS  += selftest.h \
+    baseline.h \
+    ../imageview.h \
+    ../byteswap.h \
+    ../importsettings.h \
+    ../spritedecoder.h \
+    ../pixelconvert.h \
+    ../simd.h \
+    ../importpipeline.h \
+    ../spriteencoder.h \
+    ../pallet_dta.h \
+    ../reversedither.h \
+    ../imagebands.h \
+    ../linearlight.h \
+    ../framearena.h \
+    ../tilemap.h
+
+FORMS    += ../importsettings.ui
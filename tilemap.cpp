@@ -0,0 +1,89 @@
+#include "tilemap.h"
+#include "framearena.h"
+#include <algorithm>
+
+static inline
+int neighbor(int v, int n, bool wrap)
+{
+	if(v < 0)
+	{
+		return 0;
+	}
+
+	if(v >= n)
+	{
+		return wrap? 0 : n - 1;
+	}
+
+	return v;
+}
+
+tile_map buildTileMap(const uchar * bits, int bytes_per_line, int width, int height, bool wrap)
+{
+	tile_map map;
+	map.columns = (width  + TILE_SIZE - 1) >> TILE_SHIFT;
+	map.rows    = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+
+	const int n = map.columns * map.rows;
+	uint8_t * flags = borrowScratch<uint8_t>(ARENA_TILES, 2 * n);
+	uint8_t * quiet = flags + n;
+
+	for(int ty = 0; ty < map.rows; ++ty)
+	{
+		const int y0 = ty << TILE_SHIFT;
+		const int y1 = std::min(y0 + TILE_SIZE, height);
+
+		for(int tx = 0; tx < map.columns; ++tx)
+		{
+			const int x0 = tx << TILE_SHIFT;
+			const int x1 = std::min(x0 + TILE_SIZE, width);
+
+//and of every pixel for the opaque test, or of every pixel for the transparent and clear ones
+			uint32_t all = 0xFFFFFFFF;
+			uint32_t any = 0;
+
+			for(int y = y0; y < y1; ++y)
+			{
+				const QRgb * line = reinterpret_cast<const QRgb*>(bits + y * bytes_per_line);
+
+				for(int x = x0; x < x1; ++x)
+				{
+					all &= line[x];
+					any |= line[x];
+				}
+			}
+
+			flags[ty * map.columns + tx] =
+				((any >> 24) == 0x00? TILE_TRANSPARENT : 0) |
+				((all >> 24) == 0xFF? TILE_OPAQUE : 0) |
+				(any == 0? TILE_CLEAR : 0);
+		}
+	}
+
+	for(int ty = 0; ty < map.rows; ++ty)
+	{
+		for(int tx = 0; tx < map.columns; ++tx)
+		{
+			uint8_t q = 0xFF;
+
+			for(int _y = -1; _y < 2; ++_y)
+			{
+				for(int _x = -1; _x < 2; ++_x)
+				{
+					q &= flags[neighbor(ty + _y, map.rows, wrap) * map.columns + neighbor(tx + _x, map.columns, wrap)];
+				}
+			}
+
+			quiet[ty * map.columns + tx] = q;
+		}
+	}
+
+	map.flags = flags;
+	map.quiet = quiet;
+	return map;
+}
+
+tile_map buildTileMap(const QImage & image, bool wrap)
+{
+	return buildTileMap(image.constBits(), image.bytesPerLine(), image.width(), image.height(), wrap);
+}
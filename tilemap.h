@@ -0,0 +1,34 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+#include <QImage>
+#include <cstdint>
+
+#define TILE_SHIFT 3
+#define TILE_SIZE (1 << TILE_SHIFT)
+
+enum tile_flag
+{
+	TILE_TRANSPARENT = 0x01,	//every alpha is 0
+	TILE_OPAQUE      = 0x02,	//every alpha is 255
+	TILE_CLEAR       = 0x04,	//every pixel is 0, the hidden colors too
+};
+
+//what each 8x8 tile of a frame holds, so a kernel can pass over the tiles it can't change.
+//quiet has the flags a tile shares with the 8 tiles around it; past the edge of the frame the tiles are clamped,
+//or with wrap the last row and column also see the first ones the way blur_alpha does.
+struct tile_map
+{
+	int columns, rows;
+	const uint8_t * flags;
+	const uint8_t * quiet;
+
+	uint8_t at(int tx, int ty) const { return flags[ty * columns + tx]; }
+//the quiet flags of the tiles that row y of the frame goes through
+	const uint8_t * quietRow(int y) const { return quiet + (y >> TILE_SHIFT) * columns; }
+};
+
+//the pixels are raw ARGB32 or ARGB32_Premultiplied words, the arrays belong to the thread's frame arena
+tile_map buildTileMap(const uchar * bits, int bytes_per_line, int width, int height, bool wrap = false);
+tile_map buildTileMap(const QImage & image, bool wrap = false);
+
+#endif // TILEMAP_H